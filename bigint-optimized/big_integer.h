@@ -1,7 +1,10 @@
 #include "optimized_storage.h"
 #include <vector>
 #include <string>
-#include <functional>
+#include <utility>
+#include <memory>
+#include <charconv>
+#include <iosfwd>
 
 #ifndef BIG_INTEGER_H
 #define BIG_INTEGER_H
@@ -10,13 +13,17 @@ struct big_integer {
     ///  @consts and @typedefs
 private:
     static const uint64_t BASE = static_cast<uint64_t>(UINT32_MAX) + 1;
-    using uint128_t = unsigned __int128;
-    using func = std::function<uint32_t(uint32_t, uint32_t)>;
+    static const size_t DIGITS_SPLIT_THRESHOLD = 32;  //  с этой длины (в разрядах) перевод в строку делится пополам
+    static const size_t PARSE_SPLIT_THRESHOLD = 1024;  //  с этой длины (в цифрах) разбор строки делится пополам
+
+public:
+    struct divisor;
+
+    struct parser;
 
     ///  @variables
 private:
-    optimized_storage data;  //  std::vector<uint32_t>
-    bool sign;
+    optimized_storage data;  //  std::vector<uint32_t>, знак хранится в data.negative()
 
     ///  @methods
 public:
@@ -24,16 +31,29 @@ public:
 
     big_integer(const big_integer &other);
 
+    big_integer(big_integer &&other) noexcept;  //  other становится нулём
+
     big_integer(int a);
 
     explicit big_integer(uint32_t a);
 
     explicit big_integer(const std::string &str);
 
+    //  Числа, созданные с ресурсом памяти (nullptr - ресурс по умолчанию), держат разряды в нём.
+    //  Ресурс следует за значением: копии делят его блок, а результат операции берёт память
+    //  у ресурса левого операнда. Разбор строк и ноль по умолчанию используют ресурс по умолчанию.
+    explicit big_integer(std::pmr::memory_resource *resource);
+
+    big_integer(const big_integer &other, std::pmr::memory_resource *resource);  //  копирует разряды, если ресурс другой
+
+    big_integer(const std::string &str, std::pmr::memory_resource *resource);
+
     ~big_integer();
 
     big_integer &operator=(const big_integer &other);
 
+    big_integer &operator=(big_integer &&other) noexcept;
+
     big_integer &operator+=(const big_integer &rhs);
 
     big_integer &operator-=(const big_integer &rhs);
@@ -42,6 +62,8 @@ public:
 
     big_integer &operator/=(const big_integer &rhs);
 
+    big_integer &operator/=(const divisor &rhs);
+
     big_integer &operator%=(const big_integer &rhs);
 
     big_integer &operator&=(const big_integer &rhs);
@@ -68,6 +90,15 @@ public:
 
     big_integer operator--(int);
 
+    //  степени оснований для перевода в строку и разбора кэшируются на все потоки, пока их не очистят
+    static size_t radix_cache_bytes();
+
+    static void trim_radix_cache();
+
+    std::pmr::memory_resource *resource() const;
+
+    static std::pmr::memory_resource *default_resource();  //  malloc за пулом освобождённых блоков потока
+
     friend bool operator==(const big_integer &a, const big_integer &b);
 
     friend bool operator!=(const big_integer &a, const big_integer &b);
@@ -82,11 +113,29 @@ public:
 
     friend std::string to_string(const big_integer &a);
 
+    friend std::string to_string(const big_integer &a, int base, bool show_base);
+
+    friend std::pair<big_integer, big_integer> divmod(const big_integer &a, const big_integer &b);
+
+    friend std::pair<big_integer, big_integer> divmod(const big_integer &a, const divisor &b);
+
+    friend std::to_chars_result to_chars(char *first, char *last, const big_integer &a, int base);
+
+    friend std::from_chars_result from_chars(const char *first, const char *last, big_integer &a, int base);
+
+    friend size_t to_chars_size(const big_integer &a, int base);
+
+    friend std::ostream &operator<<(std::ostream &s, const big_integer &a);
+
+    friend big_integer operator-(const big_integer &a, big_integer &&b);
+
 private:
     size_t size() const;
 
     uint32_t &operator[](size_t i);
 
+    uint32_t *digits();  //  разряды для записи в циклах: общий буфер копируется один раз, а не на каждом обращении
+
     const uint32_t &operator[](size_t i) const;
 
     uint32_t get_kth(size_t k) const;
@@ -95,8 +144,6 @@ private:
 
     static uint32_t low32_bits(uint64_t a);
 
-    static uint32_t low32_bits(uint128_t a);
-
     static uint32_t high32_bits(uint64_t a);
 
     static size_t bit_count(uint32_t a);
@@ -107,35 +154,132 @@ private:
 
     static std::pair<big_integer, uint32_t> short_div(const big_integer &a, uint32_t b);  //  {целая часть, остаток}
 
-    uint32_t trial(uint64_t k, uint64_t m, const big_integer &d) const;
+    static uint32_t normalize(uint32_t *dst, const big_integer &b);  //  dst = |b| << shift со старшим битом, вернёт shift
+
+    //  частное (n - m + 1 разрядов) и остаток (m разрядов) |a| на нормализованный d из m > 1 разрядов,
+    //  inverse - обратное к d или nullptr; делимое сдвигается во временные разряды из стека потока
+    static void divide(uint32_t *quotient, uint32_t *remainder, const big_integer &a,
+                       const uint32_t *d, size_t m, uint32_t shift, const uint32_t *inverse);
+
+    //  divide в новые числа, negative - знак делителя
+    static std::pair<big_integer, big_integer> long_div(const big_integer &a, const uint32_t *d, size_t m,
+                                                        uint32_t shift, const uint32_t *inverse, bool negative);
+
+    //  *this = *this / d или *this % d без новых чисел: частное и остаток копируются в буфер *this
+    big_integer &divide_in_place(const uint32_t *d, size_t m, uint32_t shift, const uint32_t *inverse,
+                                 bool negative, bool remainder);
+
+    static std::pair<uint32_t, size_t> radix_chunk(int base);  //  {base^c, c} для наибольшей степени, меньшей BASE
+
+    //  base^(c * 2^k) из общей для всех потоков таблицы; указатель держит степень, даже если таблицу очистят
+    static std::shared_ptr<const divisor> radix_power(int base, size_t k);
+
+    static big_integer from_limbs(std::vector<uint32_t> value);  //  без знака, пустой - ноль
+
+    //  копия в собственном блоке ресурса resource: её разряды не делятся с a, поэтому кэш степеней
+    //  можно читать из нескольких потоков и без атомарного счётчика ссылок
+    static big_integer unshared_copy(const big_integer &a, std::pmr::memory_resource *resource);
+
+    static big_integer read_digits(const char *digits, size_t n, int base);  //  только цифры
+
+    //  цифры |a| с нулями слева до width, возвращает конец записи или nullptr, если она не помещается до last
+    static char *write_digits(char *out, char *last, const big_integer &a, size_t width, int base);
 
-    bool smaller(const big_integer &dq, uint64_t k, uint64_t m) const;
+    //  то же прямо в буфер потока, по мере деления; false, если поток не принял символы
+    static bool write_digits(std::streambuf &out, const big_integer &a, size_t width, int base);
 
-    void difference(const big_integer &dq, uint64_t k, uint64_t m);
+    //  системы счисления 2^digit_bits нарезаются на биты за линейное время, a != 0
+    static char *write_pow2(char *out, const big_integer &a, unsigned digit_bits);
+
+    static big_integer read_pow2(const char *digits, size_t n, unsigned digit_bits);
+
+    static uint32_t shift_digits(uint32_t *dst, const uint32_t *src, size_t n, uint32_t shift);  //  dst = src << shift
+
+    void replace_digits(const uint32_t *src, size_t n);  //  разряды становятся src, буфер *this переиспользуется
 
     void to_additional_code(size_t n_digits);
 
-    big_integer &bitwise_operation(const big_integer &rhs, const func &f);
+    template<typename Operation>
+    big_integer &bitwise_operation(const big_integer &rhs, Operation f);  //  f - поразрядная операция
 
     void shrink_to_fit();
 };
 
+//  Делитель с предвычисленным обратным по Ньютону для многократного деления на одно число:
+//  обращение стоит нескольких умножений, а каждое деление с ним - двух на каждые size() разрядов частного
+struct big_integer::divisor {
+    explicit divisor(const big_integer &value);
+
+private:
+    big_integer value;
+    uint32_t shift;
+    std::vector<uint32_t> normalized;  //  value << shift
+    std::vector<uint32_t> inverse;  //  floor((BASE^2m - 1) / normalized), m + 1 разрядов; пуст для коротких делителей
+
+    friend struct big_integer;
+
+    friend std::pair<big_integer, big_integer> divmod(const big_integer &a, const big_integer &b);
+
+    friend std::pair<big_integer, big_integer> divmod(const big_integer &a, const divisor &b);
+};
+
+//  разбор записи, приходящей по кускам: -?цифры в системе счисления 2..36. Цифры копятся в неполный
+//  блок разрядов, полные блоки попарно сливаются, как в двоичном счётчике, так что итоговое
+//  умножение делится пополам, как в конструкторе из строки
+struct big_integer::parser {
+    explicit parser(int base = 10);
+
+    size_t feed(const char *s, size_t n);  //  число принятых символов; меньше n - запись закончилась
+
+    bool empty() const;  //  цифр ещё не было
+
+    big_integer finish();  //  runtime_error, если цифр не было; после вызова парсер снова пуст
+
+private:
+    static const size_t BLOCK_LEVEL = 5;  //  в блоке c * 2^5 цифр
+
+    void push_block();
+
+    int base;
+    std::pair<uint32_t, size_t> chunk;  //  {base^c, c}
+    bool started, negative;
+    uint32_t piece;  //  последние piece_digits < c цифр
+    size_t piece_digits;
+    std::vector<uint32_t> block;  //  block_chunks < 2^BLOCK_LEVEL полных кусков по c цифр
+    size_t block_chunks;
+    std::vector<std::pair<big_integer, size_t>> levels;  //  слитые блоки и их уровни, старшие цифры первыми
+};
+
 big_integer operator+(big_integer a, const big_integer &b);
 
+big_integer operator+(const big_integer &a, big_integer &&b);  //  результат в памяти b, если она истекает
+
 big_integer operator-(big_integer a, const big_integer &b);
 
+big_integer operator-(const big_integer &a, big_integer &&b);
+
 big_integer operator*(big_integer a, const big_integer &b);
 
+big_integer operator*(const big_integer &a, big_integer &&b);
+
 big_integer operator/(big_integer a, const big_integer &b);
 
+big_integer operator/(big_integer a, const big_integer::divisor &b);
+
 big_integer operator%(big_integer a, const big_integer &b);
 
 big_integer operator&(big_integer a, const big_integer &b);
 
+big_integer operator&(const big_integer &a, big_integer &&b);
+
 big_integer operator|(big_integer a, const big_integer &b);
 
+big_integer operator|(const big_integer &a, big_integer &&b);
+
 big_integer operator^(big_integer a, const big_integer &b);
 
+big_integer operator^(const big_integer &a, big_integer &&b);
+
 big_integer operator<<(big_integer a, int b);
 
 big_integer operator>>(big_integer a, int b);
@@ -154,6 +298,28 @@ bool operator>=(const big_integer &a, const big_integer &b);
 
 std::string to_string(const big_integer &a);
 
+//  запись в системе счисления 2..36; show_base добавляет после знака префикс 0x, 0b или 0, как std::showbase
+std::string to_string(const big_integer &a, int base, bool show_base = false);
+
+//  {a / b, a % b} за одно деление, частное округляется к нулю
+std::pair<big_integer, big_integer> divmod(const big_integer &a, const big_integer &b);
+
+std::pair<big_integer, big_integer> divmod(const big_integer &a, const big_integer::divisor &b);
+
+//  запись a в [first, last) в системе счисления 2..36 без выделения памяти под результат;
+//  если места не хватает, ec = value_too_large и ptr = last
+std::to_chars_result to_chars(char *first, char *last, const big_integer &a, int base = 10);
+
+//  разбор наибольшего префикса [first, last) вида -?цифры; если цифр нет, ec = invalid_argument и a не меняется;
+//  при base = 0 система определяется по префиксу, как в strtol: 0x - 16, 0b - 2, 0 - 8, иначе 10
+std::from_chars_result from_chars(const char *first, const char *last, big_integer &a, int base = 10);
+
+//  верхняя граница длины записи to_chars, больше точной не более чем на 2 символа
+size_t to_chars_size(const big_integer &a, int base = 10);
+
 std::ostream &operator<<(std::ostream &s, const big_integer &a);
 
+//  пропускает пробелы и читает -?цифры (std::hex и std::oct меняют систему счисления); без цифр - failbit
+std::istream &operator>>(std::istream &s, big_integer &a);
+
 #endif //BIG_INTEGER_H
\ No newline at end of file
@@ -1,13 +1,24 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <iomanip>
+#include <memory_resource>
 #include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 #include <utility>
 #include <gtest/gtest.h>
 
 #include "big_integer.h"
 #include "big_integer_gmp.h"
+#include "limb_arithmetic.h"
+#include "limb_division.h"
+#include "ntt_multiplication.h"
+#include "limb_scratch.h"
+#include "optimized_storage.h"
 
 TEST(correctness, two_plus_two) {
     EXPECT_EQ(big_integer(4), big_integer(2) + big_integer(2));
@@ -577,6 +588,629 @@ TEST(correctness, string_conv) {
     EXPECT_EQ("-2147483649", to_string(lim));
 }
 
+TEST(correctness, string_conv_long_zeros) {
+    big_integer power = 1;
+    std::string expected = "1";
+    for (size_t digits = 0; digits != 3000; ++digits) {
+        EXPECT_EQ(expected, to_string(power));
+        EXPECT_EQ("-" + expected, to_string(-power));
+        power *= 10;
+        expected += '0';
+    }
+    EXPECT_EQ(std::string(2999, '9'), to_string(power / 10 - 1));
+    EXPECT_EQ("1" + std::string(3000, '0') + "1", to_string(power * 10 + 1));
+}
+
+TEST(correctness, string_conv_long) {
+    std::default_random_engine rng(42);
+    for (const size_t length : {8, 9, 10, 1023, 1024, 1025, 20000}) {
+        std::string digits(1, static_cast<char>('1' + rng() % 9));
+        while (digits.size() < length) {
+            digits += static_cast<char>('0' + rng() % 10);
+        }
+        EXPECT_EQ(digits, to_string(big_integer(digits)));
+        EXPECT_EQ("-" + digits, to_string(big_integer("-" + digits)));
+        EXPECT_EQ(digits, to_string(big_integer(std::string(3000, '0') + digits)));
+    }
+    EXPECT_THROW(big_integer("12a4"), std::runtime_error);
+    EXPECT_THROW(big_integer(std::string(5000, '7') + "-"), std::runtime_error);
+    EXPECT_THROW(big_integer(""), std::runtime_error);
+}
+
+TEST(correctness, string_conv_non_digit) {
+    const char non_digits[] = {'/', ':', 'a', ' ', '-', '\x80', '\xff'};
+    for (size_t position = 0; position != 70; ++position) {
+        for (const char c : non_digits) {
+            std::string str(70, '5');
+            str[position] = c;
+            if (position == 0 && c == '-') {
+                continue;
+            }
+            try {
+                big_integer a(str);
+                ADD_FAILURE() << "no exception for a non-digit at " << position;
+            } catch (const std::runtime_error &e) {
+                EXPECT_EQ("Expected: digit, found: " + std::string(1, c), e.what());
+            }
+        }
+    }
+    EXPECT_EQ("99999999999999999999", to_string(big_integer("99999999999999999999")));
+    EXPECT_EQ("1234567890123456789", to_string(big_integer("1234567890123456789")));
+}
+
+TEST(correctness, to_chars_bases) {
+    std::default_random_engine rng(13);
+    const std::string digit_chars = "0123456789abcdefghijklmnopqrstuvwxyz";
+    for (size_t bits : {1u, 31u, 32u, 100u, 1500u, 5000u, 40000u}) {
+        big_integer_gmp gmp_a;
+        gmp_a.random(bits, rng);
+        const big_integer a(to_string(gmp_a));
+        for (const big_integer &x : {a, -a}) {
+            for (int base = 2; base <= 36; ++base) {
+                std::string str(to_chars_size(x, base), '?');
+                const std::to_chars_result written = to_chars(&str[0], &str[0] + str.size(), x, base);
+                ASSERT_EQ(std::errc(), written.ec);
+                EXPECT_LE(str.size(), static_cast<size_t>(written.ptr - &str[0]) + 2);
+                str.resize(static_cast<size_t>(written.ptr - &str[0]));
+                if (bits <= 1500) {
+                    std::string expected;
+                    for (big_integer rest = x < 0 ? -x : x; rest != 0; rest /= base) {
+                        expected += digit_chars[std::stoi(to_string(rest % base))];
+                    }
+                    expected += x < 0 ? "-" : expected.empty() ? "0" : "";
+                    std::reverse(expected.begin(), expected.end());
+                    EXPECT_EQ(expected, str);
+                }
+                big_integer y;
+                const std::from_chars_result read = from_chars(str.data(), str.data() + str.size(), y, base);
+                EXPECT_EQ(std::errc(), read.ec);
+                EXPECT_EQ(str.data() + str.size(), read.ptr);
+                EXPECT_EQ(x, y);
+            }
+        }
+    }
+}
+
+TEST(correctness, to_chars_buffer_too_small) {
+    const big_integer a = (big_integer(1) << 100) - 1;
+    const std::string expected = "1267650600228229401496703205375";
+    char buffer[64];
+    for (size_t size = 0; size <= expected.size() + 1; ++size) {
+        std::fill(buffer, buffer + 64, '?');
+        const std::to_chars_result written = to_chars(buffer, buffer + size, -a);
+        if (size <= expected.size()) {
+            EXPECT_EQ(std::errc::value_too_large, written.ec);
+            EXPECT_EQ(buffer + size, written.ptr);
+        } else {
+            EXPECT_EQ(std::errc(), written.ec);
+            EXPECT_EQ("-" + expected, std::string(buffer, written.ptr));
+        }
+        EXPECT_EQ('?', buffer[size]);
+    }
+    EXPECT_EQ(std::errc::invalid_argument, to_chars(buffer, buffer + 64, a, 37).ec);
+    EXPECT_EQ("0", std::string(buffer, to_chars(buffer, buffer + 1, 0, 2).ptr));
+}
+
+TEST(correctness, to_chars_exact_buffer) {
+    for (int base : {3, 10, 36}) {
+        for (int bits : {1, 40, 5000}) {
+            const big_integer a = -((big_integer(1) << bits) / 3 + 1);
+            const std::string expected = to_string(a, base);
+            std::vector<char> buffer(expected.size() + 1, '?');
+            const std::to_chars_result written = to_chars(buffer.data(), buffer.data() + expected.size(), a, base);
+            EXPECT_EQ(std::errc(), written.ec);
+            EXPECT_EQ(expected, std::string(buffer.data(), written.ptr));
+            EXPECT_EQ('?', buffer.back());
+            std::fill(buffer.begin(), buffer.end(), '?');
+            const std::to_chars_result short_by_one = to_chars(buffer.data(), buffer.data() + expected.size() - 1, a, base);
+            EXPECT_EQ(std::errc::value_too_large, short_by_one.ec);
+            EXPECT_EQ('?', buffer[expected.size() - 1]);
+        }
+    }
+}
+
+TEST(correctness, from_chars_prefix) {
+    big_integer a = 7;
+    const std::string bad[] = {"", "-", "x1", "-x", "+1", " 1"};
+    for (const std::string &str : bad) {
+        const std::from_chars_result read = from_chars(str.data(), str.data() + str.size(), a);
+        EXPECT_EQ(std::errc::invalid_argument, read.ec);
+        EXPECT_EQ(str.data(), read.ptr);
+        EXPECT_EQ(7, a);
+    }
+    const std::string hex = "-DeadBeefCafeBabe1234g5";
+    const std::from_chars_result read = from_chars(hex.data(), hex.data() + hex.size(), a, 16);
+    EXPECT_EQ(std::errc(), read.ec);
+    EXPECT_EQ(hex.data() + hex.find('g'), read.ptr);
+    EXPECT_EQ(big_integer("-1051570404360395033547316"), a);
+    const std::string zero = "-000";
+    from_chars(zero.data(), zero.data() + zero.size(), a, 2);
+    EXPECT_EQ(0, a);
+    EXPECT_EQ("0", to_string(a));
+    EXPECT_EQ(std::errc::invalid_argument, from_chars(zero.data(), zero.data() + zero.size(), a, 1).ec);
+}
+
+TEST(correctness, pow2_radix_prefix) {
+    const big_integer a("-1051570404360395033547316");
+    EXPECT_EQ("-deadbeefcafebabe1234", to_string(a, 16));
+    EXPECT_EQ("-0xdeadbeefcafebabe1234", to_string(a, 16, true));
+    EXPECT_EQ("0b101", to_string(5, 2, true));
+    EXPECT_EQ("017", to_string(15, 8, true));
+    EXPECT_EQ("0", to_string(0, 16, true));
+    EXPECT_THROW(to_string(a, 64), std::invalid_argument);
+
+    std::ostringstream out;
+    out << std::hex << std::showbase << std::uppercase << a << ' ' << std::oct << big_integer(8);
+    EXPECT_EQ("-0XDEADBEEFCAFEBABE1234 010", out.str());
+
+    const std::pair<std::string, std::string> prefixed[] = {
+            {"-0xDeadBeefCafeBabe1234", "-1051570404360395033547316"},
+            {"0b1011", "11"}, {"0755", "493"}, {"0x", "0"}, {"0xg", "0"}, {"0", "0"}, {"123", "123"}};
+    for (const auto &test : prefixed) {
+        big_integer b;
+        const std::from_chars_result read = from_chars(test.first.data(), test.first.data() + test.first.size(), b, 0);
+        EXPECT_EQ(std::errc(), read.ec);
+        EXPECT_EQ(big_integer(test.second), b);
+    }
+}
+
+TEST(correctness, pow2_radix_long) {
+    std::default_random_engine rng(14);
+    big_integer_gmp gmp_a;
+    gmp_a.random(100000, rng);
+    const big_integer a(to_string(gmp_a));
+    for (int base : {2, 4, 8, 16, 32}) {
+        const std::string str = to_string(a, base);
+        EXPECT_EQ(to_chars_size(a, base), str.size());
+        big_integer b;
+        EXPECT_EQ(str.data() + str.size(), from_chars(str.data(), str.data() + str.size(), b, base).ptr);
+        EXPECT_EQ(a, b);
+    }
+}
+
+TEST(correctness, stream_output) {
+    std::default_random_engine rng(15);
+    big_integer_gmp gmp_a;
+    gmp_a.random(50000, rng);
+    const big_integer a(to_string(gmp_a));
+    for (const big_integer &x : {a, -a, a / (big_integer(1) << 40000), big_integer(), big_integer(-7)}) {
+        std::ostringstream out;
+        out << x << ' ' << std::setw(8) << std::setfill('*') << big_integer(-5) << std::setw(0) << x;
+        EXPECT_EQ(to_string(x) + " ******-5" + to_string(x), out.str());
+    }
+    const big_integer power("1" + std::string(5000, '0'));
+    std::ostringstream out;
+    out << power - 1 << power;
+    EXPECT_EQ(std::string(5000, '9') + "1" + std::string(5000, '0'), out.str());
+}
+
+TEST(correctness, stream_input) {
+    std::istringstream in("  -123456789012345678901234567890 42\n0 -0 +5");
+    big_integer a, b, c, d, e = 7;
+    in >> a >> b >> c >> d;
+    EXPECT_EQ(big_integer("-123456789012345678901234567890"), a);
+    EXPECT_EQ(42, b);
+    EXPECT_EQ(0, c);
+    EXPECT_EQ(0, d);
+    EXPECT_EQ("0", to_string(d));
+    EXPECT_FALSE(in >> e);
+    EXPECT_EQ(7, e);
+
+    std::istringstream hex("-DeadBeefCafeBabe1234");
+    hex >> std::hex >> a;
+    EXPECT_TRUE(hex.eof());
+    EXPECT_EQ(big_integer("-1051570404360395033547316"), a);
+
+    std::istringstream minus("- 1");
+    EXPECT_FALSE(minus >> e);
+    EXPECT_EQ(7, e);
+}
+
+TEST(correctness, push_parser) {
+    std::default_random_engine rng(16);
+    for (size_t bits : {1u, 100u, 3000u, 70000u}) {
+        big_integer_gmp gmp_a;
+        gmp_a.random(bits, rng);
+        const std::string str = to_string(gmp_a);
+        for (size_t piece : {1u, 7u, 1000u}) {
+            big_integer::parser parser;
+            EXPECT_TRUE(parser.empty());
+            for (size_t i = 0; i < str.size(); i += piece) {
+                const size_t n = std::min(piece, str.size() - i);
+                EXPECT_EQ(n, parser.feed(str.data() + i, n));
+            }
+            EXPECT_EQ(0u, parser.feed("-", 1));
+            EXPECT_EQ(big_integer(str), parser.finish());
+            EXPECT_TRUE(parser.empty());
+        }
+    }
+    big_integer::parser parser(2);
+    EXPECT_EQ(4u, parser.feed("-1012", 5));
+    EXPECT_EQ(-5, parser.finish());
+    EXPECT_THROW(parser.finish(), std::runtime_error);
+}
+
+TEST(correctness, rvalue_operators) {
+    static_assert(std::is_nothrow_move_constructible<big_integer>::value, "big_integer moves must not throw");
+    static_assert(std::is_nothrow_move_assignable<big_integer>::value, "big_integer moves must not throw");
+    const big_integer values[] = {big_integer("123456789012345678901234567890"), big_integer("-98765432109876543210"),
+                                  big_integer(0), big_integer(-1), big_integer(1) << 100};
+    for (const big_integer &a : values) {
+        for (const big_integer &b : values) {
+            EXPECT_EQ(a + b, a + big_integer(b));
+            EXPECT_EQ(a - b, a - big_integer(b));
+            EXPECT_EQ(a * b, a * big_integer(b));
+            EXPECT_EQ(a & b, a & big_integer(b));
+            EXPECT_EQ(a | b, a | big_integer(b));
+            EXPECT_EQ(a ^ b, a ^ big_integer(b));
+            EXPECT_EQ(b - a, big_integer(b) - big_integer(a));
+        }
+    }
+    big_integer a = values[0];
+    big_integer b = std::move(a);
+    a = b * 2;
+    EXPECT_EQ(values[0], b);
+    EXPECT_EQ(values[0] + values[0], a);
+}
+
+TEST(correctness, bitwise_result_carries_out) {
+    // the two's complement result is all zeros, so its magnitude needs one more limb
+    EXPECT_EQ(-(big_integer(1) << 32), (1 - (big_integer(1) << 32)) & -2);
+    EXPECT_EQ(-(big_integer(1) << 256), -((big_integer(1) << 256) - 1) & big_integer("-8869916364"));
+    EXPECT_EQ(-(big_integer(1) << 64), -((big_integer(1) << 64) - 1) & -((big_integer(1) << 33) + 2));
+}
+
+TEST(correctness, negative_shift_past_top) {
+    for (int shift : {31, 32, 33, 64, 160, 300}) {
+        EXPECT_EQ(-1, big_integer(-5) >> shift);
+        EXPECT_EQ(0, big_integer(5) >> shift);
+    }
+    const big_integer b = -(big_integer(1) << 100) + 3;
+    for (int shift : {100, 101, 128, 160, 300}) {
+        EXPECT_EQ(-1, b >> shift);
+        EXPECT_EQ(0, -b >> shift);
+    }
+    big_integer a = -(big_integer(1) << 64);
+    a >>= 96;
+    EXPECT_EQ(-1, a);
+    EXPECT_EQ(0, a + 1);
+}
+
+TEST(correctness, shr_negative_floor) {
+    EXPECT_EQ(-9000, big_integer(-9000) >> 0);
+    EXPECT_EQ(-2, big_integer(-4) >> 1);
+    EXPECT_EQ(-1, big_integer(-8) >> 3);
+    EXPECT_EQ(-2, big_integer(-9) >> 3);
+    EXPECT_EQ(-(big_integer(1) << 36), -(big_integer(1) << 100) >> 64);
+    EXPECT_EQ(-(big_integer(1) << 36) - 1, (-1 - (big_integer(1) << 100)) >> 64);
+    EXPECT_EQ(-3, (-3 * (big_integer(1) << 70)) >> 70);
+    big_integer a = -(big_integer(1) << 96) - (big_integer(1) << 40);
+    a >>= 40;
+    EXPECT_EQ(-(big_integer(1) << 56) - 1, a);
+}
+
+TEST(correctness, moved_from_is_zero) {
+    for (const big_integer &value : {big_integer(-7), -(big_integer(1) << 300) + 1}) {
+        big_integer a = value;
+        big_integer b = std::move(a);
+        EXPECT_EQ(value, b);
+        EXPECT_EQ("0", to_string(a));
+        EXPECT_EQ(0, a);
+        a += 5;
+        EXPECT_EQ(5, a);
+        big_integer c = value;
+        c = std::move(b);
+        EXPECT_EQ(value, c);
+        EXPECT_EQ("0", to_string(b));
+        EXPECT_EQ(-value, b - c);
+    }
+}
+
+TEST(correctness, moved_from_in_expressions) {
+    const big_integer value = (big_integer(1) << 100) - 3;
+    auto moved_from = [&value]() {
+        big_integer a = value;
+        big_integer b = std::move(a);
+        return a;
+    };
+    EXPECT_EQ(0, moved_from() * value);
+    EXPECT_EQ(value, value + moved_from());
+    EXPECT_EQ(-value, moved_from() - value);
+    EXPECT_EQ(0, moved_from() / value);
+    EXPECT_EQ(-1, ~moved_from());
+    EXPECT_EQ(value, moved_from() | value);
+    EXPECT_EQ(0, moved_from() << 70);
+    EXPECT_EQ(0, moved_from() >> 70);
+    EXPECT_TRUE(moved_from() < value);
+    EXPECT_EQ(moved_from(), -moved_from());
+    big_integer a = moved_from();
+    EXPECT_EQ(0, a);
+    a *= value;
+    EXPECT_EQ(0, a);
+}
+
+TEST(correctness, shared_copy_mutation) {
+    const big_integer original = (big_integer(1) << 200) - 12345;
+    for (int shift : {0, 1, 31, 32, 33, 64, 250}) {
+        big_integer a = original, b = original, c = original, d = original;
+        a <<= shift;
+        b >>= shift;
+        c += c;
+        d -= original;
+        EXPECT_EQ((big_integer(1) << (200 + shift)) - 12345 * (big_integer(1) << shift), a);
+        EXPECT_EQ(original / (big_integer(1) << shift), b);
+        EXPECT_EQ(original * 2, c);
+        EXPECT_EQ(0, d);
+        EXPECT_EQ((big_integer(1) << 200) - 12345, original);
+    }
+    big_integer a = -original, b = a;
+    a &= original;
+    EXPECT_EQ(-original, b);
+    EXPECT_EQ(1, a);
+}
+
+TEST(correctness, storage_push_back_growth) {
+    optimized_storage a(1, 7);
+    for (uint32_t i = 0; i < 100000; ++i) {
+        a.push_back(i);
+    }
+    optimized_storage b(a);
+    b.push_back(1);
+    b[0] = 8;
+    a.pop_back();
+    ASSERT_EQ(100000u, a.size());
+    ASSERT_EQ(100002u, b.size());
+    EXPECT_EQ(7u, a[0]);
+    EXPECT_EQ(8u, b[0]);
+    EXPECT_EQ(99998u, a.back());
+    EXPECT_EQ(1u, b.back());
+    for (uint32_t i = 0; i + 1 < 100000; ++i) {
+        ASSERT_EQ(i, a[i + 1]);
+        ASSERT_EQ(i, b[i + 1]);
+    }
+}
+
+#ifdef BIGINT_ATOMIC_REFCOUNT
+TEST(correctness, shared_copies_across_threads) {
+    const big_integer value = (big_integer(1) << 5000) - 1;
+    std::vector<std::thread> threads;
+    std::vector<int> matches(8, 0);
+    for (size_t t = 0; t < matches.size(); ++t) {
+        threads.emplace_back([&value, &matches, t]() {
+            for (int i = 0; i < 2000; ++i) {
+                big_integer copy = value;
+                big_integer other = copy;
+                other += i;
+                matches[t] += copy == value && other - i == value;
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(std::vector<int>(matches.size(), 2000), matches);
+}
+#endif
+
+TEST(correctness, storage_demotes_to_inline) {
+    const auto is_inline = [](const optimized_storage &s) {
+        const auto *begin = reinterpret_cast<const char *>(&s);
+        const auto *digits = reinterpret_cast<const char *>(s.data());
+        return begin <= digits && digits < begin + sizeof(s);
+    };
+    optimized_storage a(1, 5);
+    EXPECT_TRUE(is_inline(a));
+    for (uint32_t i = 0; i < 40; ++i) {
+        a.push_back(i);
+    }
+    EXPECT_FALSE(is_inline(a));
+    const optimized_storage shared(a);
+    while (a.size() > 1) {
+        a.pop_back();
+    }
+    EXPECT_TRUE(is_inline(a));
+    EXPECT_EQ(5u, a[0]);
+    EXPECT_EQ(41u, shared.size());
+    EXPECT_EQ(39u, shared.back());
+    a.push_back(6);
+    EXPECT_EQ(6u, a.back());
+    EXPECT_EQ(optimized_storage(shared), shared);
+}
+
+TEST(correctness, compact_layout) {
+    if (BIGINT_INLINE_LIMBS * sizeof(uint32_t) <= sizeof(void *)) {
+        EXPECT_EQ(2 * sizeof(void *), sizeof(big_integer));
+    }
+    std::vector<big_integer> values = {big_integer(-5), big_integer(-1) << 100, big_integer(7)};
+    std::swap(values[0], values[1]);
+    EXPECT_EQ(big_integer(-1) << 100, values[0]);
+    EXPECT_EQ(-5, values[1]);
+    values[2] = values[0];
+    values[0] = -values[0];
+    EXPECT_EQ(big_integer(1) << 100, values[0]);
+    EXPECT_EQ(big_integer(-1) << 100, values[2]);
+}
+
+TEST(correctness, storage_block_pool) {
+    shared_vector::trim_pool();
+    EXPECT_EQ(0u, shared_vector::pool_statistics().cached_blocks);
+    const big_integer a = (big_integer(1) << 1000) - 1;
+    {
+        big_integer b = a;
+        b += 1;
+        big_integer c = a * a;
+    }
+    const shared_vector::pool_stats cached = shared_vector::pool_statistics();
+    EXPECT_LT(0u, cached.cached_blocks);
+    EXPECT_LT(0u, cached.cached_bytes);
+    for (int i = 0; i < 100; ++i) {
+        big_integer b = a;
+        b -= i;
+        EXPECT_EQ(a - i, b);
+    }
+    const shared_vector::pool_stats reused = shared_vector::pool_statistics();
+    EXPECT_LE(cached.hits + 100, reused.hits);
+    shared_vector::trim_pool();
+    EXPECT_EQ(0u, shared_vector::pool_statistics().cached_blocks);
+    EXPECT_EQ(0u, shared_vector::pool_statistics().cached_bytes);
+}
+
+namespace {
+    struct counting_resource : std::pmr::memory_resource {
+        std::pmr::monotonic_buffer_resource arena;
+        size_t allocations = 0;
+        size_t live = 0;
+
+        void *do_allocate(size_t bytes, size_t alignment) override {
+            ++allocations;
+            ++live;
+            return arena.allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+            --live;
+            arena.deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+    };
+}
+
+TEST(correctness, memory_resource_left_operand) {
+    counting_resource resource;
+    {
+        const big_integer a((big_integer(1) << 300) - 12345, &resource);
+        const big_integer b = (big_integer(1) << 200) + 777;
+        const big_integer expected_a = (big_integer(1) << 300) - 12345;
+        EXPECT_EQ(&resource, a.resource());
+        EXPECT_EQ(big_integer::default_resource(), b.resource());
+        EXPECT_EQ(expected_a, a);
+        EXPECT_LT(0u, resource.allocations);
+
+        EXPECT_EQ(&resource, (a + b).resource());
+        EXPECT_EQ(&resource, (a - b).resource());
+        EXPECT_EQ(&resource, (a * b).resource());
+        EXPECT_EQ(&resource, (a / b).resource());
+        EXPECT_EQ(&resource, (a % b).resource());
+        EXPECT_EQ(&resource, (a & b).resource());
+        EXPECT_EQ(&resource, (a << 77).resource());
+        EXPECT_EQ(&resource, (-a + b).resource());
+        EXPECT_EQ(&resource, (-a - b).resource());
+        EXPECT_EQ(&resource, ((a >> 150) - b).resource());
+        EXPECT_EQ(&resource, (a - big_integer(b)).resource());
+        EXPECT_EQ(&resource, (a / 7).resource());
+        EXPECT_EQ(&resource, (a / (b << 200)).resource());
+        EXPECT_EQ(&resource, (a >> 1000).resource());
+        EXPECT_EQ(big_integer::default_resource(), (b * a).resource());
+
+        EXPECT_EQ(expected_a * b, a * b);
+        EXPECT_EQ(expected_a / b, a / b);
+        EXPECT_EQ(expected_a - b, a - big_integer(b));
+        EXPECT_EQ(-expected_a + b, -a + b);
+
+        big_integer small(big_integer(5), &resource);  //  короткие числа не уходят во встроенный буфер
+        small += 1;
+        small *= 7;
+        EXPECT_EQ(42, small);
+        EXPECT_EQ(&resource, small.resource());
+        EXPECT_EQ(&resource, big_integer(small).resource());
+
+        big_integer parsed(&resource);
+        const std::string text = "-123456789012345678901234567890";
+        EXPECT_EQ(std::errc(), from_chars(text.data(), text.data() + text.size(), parsed).ec);
+        EXPECT_EQ(big_integer(text), parsed);
+        EXPECT_EQ(&resource, parsed.resource());
+        EXPECT_EQ(parsed, big_integer(text, &resource));
+
+        const big_integer back(a, nullptr);
+        EXPECT_EQ(big_integer::default_resource(), back.resource());
+        EXPECT_EQ(expected_a, back);
+    }
+    EXPECT_EQ(0u, resource.live);
+}
+
+TEST(correctness, scratch_buffers_lifo) {
+    limbs::scratch_buffer::trim();
+    EXPECT_EQ(0u, limbs::scratch_buffer::reserved_bytes());
+    {
+        limbs::scratch_buffer a(10, 7);
+        {
+            limbs::scratch_buffer b(100000, 1);  //  does not fit the first chunk
+            limbs::scratch_buffer c(5, 2);
+            EXPECT_EQ(1u, b[99999]);
+            EXPECT_EQ(2u, c[4]);
+        }
+        limbs::scratch_buffer d(20, 3);
+        EXPECT_EQ(7u, a[9]);
+        EXPECT_EQ(3u, d[19]);
+        EXPECT_LE(100000 * sizeof(uint32_t), limbs::scratch_buffer::reserved_bytes());
+    }
+    limbs::scratch_buffer::trim();
+    EXPECT_EQ(0u, limbs::scratch_buffer::reserved_bytes());
+}
+
+TEST(correctness, arithmetic_steady_state) {
+    const big_integer m = (big_integer(1) << 2000) - 159;
+    const big_integer y = (big_integer(1) << 1999) / 7 + 12345;
+    const big_integer d = (big_integer(1) << 1200) / 11 + 1;
+    const big_integer mask = (big_integer(1) << 1500) - 1;
+    big_integer x = (big_integer(1) << 1990) / 3;
+    big_integer z;
+    auto step = [&]() {
+        x *= y;
+        x %= m;
+        z = -x;
+        z /= d;
+        z &= mask;
+        z ^= y;
+    };
+    for (int i = 0; i < 3; ++i) {
+        step();
+    }
+    const size_t reserved = limbs::scratch_buffer::reserved_bytes();
+    const size_t misses = shared_vector::pool_statistics().misses;
+    for (int i = 0; i < 100; ++i) {
+        step();
+    }
+    EXPECT_EQ(reserved, limbs::scratch_buffer::reserved_bytes());
+    EXPECT_EQ(misses, shared_vector::pool_statistics().misses);
+    EXPECT_LT(x, m);
+    EXPECT_LE(big_integer(0), x);
+}
+
+TEST(correctness, radix_cache_trim) {
+    big_integer::trim_radix_cache();
+    EXPECT_EQ(0u, big_integer::radix_cache_bytes());
+    const big_integer a = (big_integer(1) << 20000) - 1;
+    const std::string expected = to_string(a);
+    EXPECT_LT(0u, big_integer::radix_cache_bytes());
+    big_integer::trim_radix_cache();
+    EXPECT_EQ(0u, big_integer::radix_cache_bytes());
+    EXPECT_EQ(expected, to_string(a));
+    EXPECT_EQ(a, big_integer(expected));
+}
+
+TEST(correctness, radix_cache_across_threads) {
+    const std::string expected = to_string((big_integer(1) << 20000) - 1);
+    std::vector<std::thread> threads;
+    std::vector<int> matches(4, 0);
+    for (size_t t = 0; t < matches.size(); ++t) {
+        threads.emplace_back([&expected, &matches, t]() {
+            const big_integer value = (big_integer(1) << 20000) - 1;
+            for (int i = 0; i < 5; ++i) {
+                matches[t] += to_string(value) == expected && big_integer(expected) == value;
+                big_integer::trim_radix_cache();  //  the other threads keep the powers they hold
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(std::vector<int>(matches.size(), 5), matches);
+}
+
 namespace {
     size_t const number_of_iterations = 10;
     size_t const max_size = 2048;
@@ -690,6 +1324,67 @@ TEST(correctness, div_randomized) {
     }
 }
 
+TEST(correctness, div_digit_estimation) {
+    // all-ones and sparse limbs make the quotient digit estimate too large
+    std::vector<big_integer> values;
+    for (int high : {64, 96, 160, 320}) {
+        for (int low : {0, 1, 31, 32, 33, 63}) {
+            values.push_back((big_integer(1) << high) - (big_integer(1) << low));
+            values.push_back((big_integer(1) << high) + (big_integer(1) << low));
+            values.push_back(-(big_integer(1) << high) + 1);
+        }
+    }
+    for (const big_integer &a : values) {
+        for (const big_integer &b : values) {
+            big_integer_gmp gmp_a(to_string(a)), gmp_b(to_string(b));
+            EXPECT_EQ(to_string(gmp_a / gmp_b), to_string(a / b));
+            EXPECT_EQ(to_string(gmp_a % gmp_b), to_string(a % b));
+            big_integer square = a * a;
+            EXPECT_EQ(to_string(gmp_a * gmp_a / gmp_b), to_string(square / b));
+            EXPECT_EQ(to_string(gmp_a * gmp_a % gmp_b), to_string(square % b));
+        }
+    }
+}
+
+TEST(correctness, short_div_all_shifts) {
+    std::default_random_engine rng(42);
+    big_integer_gmp gmp_a;
+    gmp_a.random(max_size, rng);
+    big_integer a(to_string(gmp_a));
+    for (int shift = 0; shift < 32; ++shift) {
+        for (uint32_t delta : {0u, 1u, 12345u}) {
+            std::string divisor = std::to_string((1ull << shift) + delta);
+            big_integer_gmp gmp_b(divisor);
+            big_integer b(divisor);
+            EXPECT_EQ(to_string(gmp_a / gmp_b), to_string(a / b));
+            EXPECT_EQ(to_string(gmp_a % gmp_b), to_string(a % b));
+        }
+    }
+}
+
+TEST(correctness, div_negative_pow2) {
+    big_integer a = -(big_integer(1) << 65);
+    EXPECT_EQ(-2, a / (big_integer(1) << 64));
+    EXPECT_EQ(-1, (a + 1) / (big_integer(1) << 64));
+    EXPECT_EQ(0, a % (big_integer(1) << 64));
+}
+
+TEST(correctness, divmod) {
+    const int values[] = {7, -7, 100, -100};
+    for (const int a : values) {
+        for (const int b : {2, -2, 7, -7}) {
+            const std::pair<big_integer, big_integer> ans = divmod(a, b);
+            EXPECT_EQ(a / b, ans.first);
+            EXPECT_EQ(a % b, ans.second);
+        }
+    }
+    big_integer a("-1000000000000000000000000000000000000001"), b("1000000000000000000000");
+    const std::pair<big_integer, big_integer> ans = divmod(a, b);
+    EXPECT_EQ(big_integer("-1000000000000000000"), ans.first);
+    EXPECT_EQ(-1, ans.second);
+    EXPECT_EQ(a, ans.first * b + ans.second);
+}
+
 // y2019 tests
 
 TEST(correctness_random, cmp) {
@@ -744,6 +1439,136 @@ TEST(correctness_random, mul) {
     }
 }
 
+namespace {
+    ///  temporarily changes a tuning threshold, so that small numbers go through fast algorithms
+    struct threshold_guard {
+        threshold_guard(size_t &threshold, size_t value) : threshold(threshold), saved(threshold) {
+            threshold = value;
+        }
+
+        ~threshold_guard() {
+            threshold = saved;
+        }
+
+    private:
+        size_t &threshold;
+        size_t saved;
+    };
+
+    void check_sqr(size_t size, size_t iterations, std::default_random_engine &rng) {
+        for (size_t itn = 0; itn != iterations; ++itn) {
+            big_integer_gmp a;
+            a.random(size, rng);
+            big_integer_gmp c = a * a;
+            big_integer R = big_integer(to_string(a));
+            big_integer copy = R;
+            EXPECT_EQ(to_string(c), to_string(R * R));
+            EXPECT_EQ(to_string(c), to_string(R * big_integer(to_string(a))));
+            R *= R;
+            EXPECT_EQ(to_string(c), to_string(R));
+            copy *= -copy;
+            EXPECT_EQ(to_string(-c), to_string(copy));
+        }
+    }
+
+    void check_mul(size_t a_size, size_t b_size, size_t iterations, std::default_random_engine &rng) {
+        for (size_t itn = 0; itn != iterations; ++itn) {
+            big_integer_gmp a, b;
+            a.random(a_size, rng);
+            b.random(b_size, rng);
+            big_integer_gmp c = a * b;
+            big_integer R = big_integer(to_string(a)) * big_integer(to_string(b));
+            EXPECT_EQ(to_string(c), to_string(R));
+        }
+    }
+
+    void check_div(size_t a_size, size_t b_size, size_t iterations, std::default_random_engine &rng) {
+        for (size_t itn = 0; itn != iterations; ++itn) {
+            big_integer_gmp a, b;
+            a.random(a_size, rng);
+            b.random(b_size, rng);
+            EXPECT_EQ(to_string(a / b), to_string(big_integer(to_string(a)) / big_integer(to_string(b))));
+            EXPECT_EQ(to_string(a % b), to_string(big_integer(to_string(a)) % big_integer(to_string(b))));
+        }
+    }
+}
+
+TEST(correctness_random, mul_karatsuba) {
+    std::default_random_engine rng(42);
+    check_mul(20 * max_size, 20 * max_size, 2, rng);
+    check_mul(20 * max_size, 3 * max_size, 2, rng);
+    check_mul(3 * max_size, 7 * max_size, 2, rng);
+}
+
+TEST(correctness_random, mul_karatsuba_small_threshold) {
+    threshold_guard guard(limbs::karatsuba_threshold, 2);
+    std::default_random_engine rng(42);
+    check_mul(max_size, max_size, number_of_iterations, rng);
+    check_mul(max_size, max_size / 3, number_of_iterations, rng);
+    check_mul(100, 70, number_of_iterations, rng);
+}
+
+TEST(correctness_random, mul_toom) {
+    std::default_random_engine rng(42);
+    check_mul(30 * max_size, 30 * max_size, 1, rng);
+    check_mul(40 * max_size, 30 * max_size, 1, rng);
+    check_mul(55 * max_size, 30 * max_size, 1, rng);
+    check_mul(70 * max_size, 30 * max_size, 1, rng);
+}
+
+TEST(correctness_random, mul_ntt) {
+    limbs::ntt_trim();
+    std::default_random_engine rng(42);
+    check_mul(40 * max_size, 40 * max_size, 1, rng);
+    check_mul(64 * max_size, 33 * max_size, 1, rng);
+    check_sqr(40 * max_size, 1, rng);
+    EXPECT_LT(0u, limbs::ntt_reserved_bytes());  // the default thresholds reached the transforms
+}
+
+TEST(correctness_random, mul_toom_small_threshold) {
+    threshold_guard karatsuba(limbs::karatsuba_threshold, 4);
+    threshold_guard toom(limbs::toom_threshold, 16);
+    std::default_random_engine rng(42);
+    for (size_t percent = 100; percent <= 300; percent += 10) {
+        check_mul(max_size, max_size * 100 / percent, 2, rng);
+    }
+    check_mul(4 * max_size, 4 * max_size, number_of_iterations, rng);
+}
+
+TEST(correctness_random, mul_ntt_small_threshold) {
+    threshold_guard ntt(limbs::ntt_threshold, 16);
+    std::default_random_engine rng(42);
+    check_mul(max_size, max_size, number_of_iterations, rng);
+    check_mul(4 * max_size, max_size, number_of_iterations, rng);
+    check_mul(100, 1000, number_of_iterations, rng);
+}
+
+TEST(correctness_random, sqr_ntt_small_threshold) {
+    threshold_guard ntt(limbs::ntt_threshold, 16);
+    std::default_random_engine rng(42);
+    check_sqr(4 * max_size, number_of_iterations, rng);
+}
+
+TEST(correctness_random, ntt_trim) {
+    threshold_guard ntt(limbs::ntt_threshold, 16);
+    std::default_random_engine rng(42);
+    check_mul(max_size, max_size, 1, rng);
+    EXPECT_LT(0u, limbs::ntt_reserved_bytes());
+    limbs::ntt_trim();
+    EXPECT_EQ(0u, limbs::ntt_reserved_bytes());
+    check_mul(max_size, max_size, 1, rng);  //  the tables are rebuilt
+}
+
+TEST(correctness_random, sqr) {
+    std::default_random_engine rng(42);
+    check_sqr(max_size, number_of_iterations, rng);
+    check_sqr(30 * max_size, 1, rng);
+    threshold_guard karatsuba(limbs::karatsuba_threshold, 4);
+    check_sqr(max_size, number_of_iterations, rng);
+    threshold_guard toom(limbs::toom_threshold, 16);
+    check_sqr(4 * max_size, number_of_iterations, rng);
+}
+
 TEST(correctness_random, div) {
     std::default_random_engine rng(322);
     for (size_t itn = 0; itn != number_of_iterations; ++itn) {
@@ -760,6 +1585,48 @@ TEST(correctness_random, div) {
     }
 }
 
+TEST(correctness_random, div_burnikel_ziegler) {
+    std::default_random_engine rng(322);
+    check_div(30 * max_size, 10 * max_size, 1, rng);
+    check_div(30 * max_size, 18 * max_size, 1, rng);
+    check_div(30 * max_size, 4 * max_size, 1, rng);
+}
+
+TEST(correctness_random, div_burnikel_ziegler_small_threshold) {
+    threshold_guard bz(limbs::bz_threshold, 4);
+    threshold_guard karatsuba(limbs::karatsuba_threshold, 4);
+    std::default_random_engine rng(322);
+    check_div(max_size, max_size / 2, number_of_iterations, rng);
+    check_div(max_size, max_size / 3, number_of_iterations, rng);
+    check_div(max_size, max_size * 2 / 3, number_of_iterations, rng);
+    check_div(4 * max_size, max_size / 4, number_of_iterations, rng);
+    check_div(300, 200, number_of_iterations, rng);
+}
+
+TEST(correctness_random, div_newton_small_threshold) {
+    threshold_guard newton(limbs::newton_threshold, 8);
+    threshold_guard karatsuba(limbs::karatsuba_threshold, 4);
+    std::default_random_engine rng(322);
+    check_div(max_size, max_size / 2, number_of_iterations, rng);
+    check_div(max_size, max_size / 3, number_of_iterations, rng);
+    check_div(4 * max_size, max_size / 4, number_of_iterations, rng);
+    check_div(4 * max_size, 3 * max_size, number_of_iterations, rng);
+    check_div(300, 200, number_of_iterations, rng);
+}
+
+TEST(correctness_random, div_reused_divisor) {
+    threshold_guard newton(limbs::newton_threshold, 8);
+    std::default_random_engine rng(322);
+    big_integer_gmp b;
+    b.random(max_size / 2, rng);
+    const big_integer::divisor d(big_integer(to_string(b)));
+    for (size_t itn = 0; itn != number_of_iterations; ++itn) {
+        big_integer_gmp a;
+        a.random(max_size * (itn + 1) / 4, rng);
+        EXPECT_EQ(to_string(a / b), to_string(big_integer(to_string(a)) / d));
+    }
+}
+
 TEST(correctness_random, mod) {
     std::default_random_engine rng(322);
     for (size_t itn = 0; itn != number_of_iterations; ++itn) {
@@ -776,6 +1643,18 @@ TEST(correctness_random, mod) {
     }
 }
 
+TEST(correctness_random, divmod) {
+    std::default_random_engine rng(322);
+    for (size_t itn = 0; itn != number_of_iterations; ++itn) {
+        big_integer_gmp a, b;
+        a.random(max_size, rng);
+        b.random(max_size / 2, rng);
+        const std::pair<big_integer, big_integer> ans = divmod(big_integer(to_string(a)), big_integer(to_string(b)));
+        EXPECT_EQ(to_string(a / b), to_string(ans.first));
+        EXPECT_EQ(to_string(a % b), to_string(ans.second));
+    }
+}
+
 TEST(correctness_random, bitwise) {
     std::default_random_engine rng(42);
     for (size_t itn = 0; itn != number_of_iterations; ++itn) {
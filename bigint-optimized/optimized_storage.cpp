@@ -1,33 +1,68 @@
 #include "optimized_storage.h"
 #include <cassert>
+#include <algorithm>
+#include <utility>
 
-optimized_storage::optimized_storage(size_t size, uint32_t val) {
-    if (size > MAX_STATIC_SIZE) {
-        ptr = new shared_vector(size, val);
+optimized_storage::optimized_storage(size_t size, uint32_t val, std::pmr::memory_resource *resource) : negative_(0) {
+    static_assert(MAX_STATIC_SIZE * sizeof(uint32_t) > sizeof(shared_vector *)
+                  || sizeof(optimized_storage) == sizeof(shared_vector *) + sizeof(size_t),
+                  "size and flags must share one word");
+    if (size > MAX_STATIC_SIZE || !is_default(resource)) {
+        ptr = shared_vector::create(size, val, resource ? resource : shared_vector::default_resource());
+        small = false;
     } else {
         std::fill(static_data.begin(), static_data.begin() + size, val);
         std::fill(static_data.begin() + size, static_data.end(), 0);
+        small = true;
     }
-    set_size(size);
+    size_ = size;
 }
 
-optimized_storage::optimized_storage(const optimized_storage &other) {
+optimized_storage::optimized_storage(std::vector<uint32_t> digits, std::pmr::memory_resource *resource) : negative_(0) {
+    const size_t size = digits.size();
+    if (size > MAX_STATIC_SIZE || !is_default(resource)) {
+        ptr = shared_vector::create(digits.data(), size, resource ? resource : shared_vector::default_resource());
+        small = false;
+    } else {
+        std::copy(digits.begin(), digits.end(), static_data.begin());
+        std::fill(static_data.begin() + size, static_data.end(), 0);
+        small = true;
+    }
+    size_ = size;
+}
+
+optimized_storage::optimized_storage(const optimized_storage &other) : negative_(other.negative_) {
     if (other.small) {
         static_data = other.static_data;
-    } else if (other.size_ <= MAX_STATIC_SIZE) {
+        small = true;
+    } else if (other.size_ <= MAX_STATIC_SIZE && is_default(other.ptr->resource)) {
         fill_static_from_other_dynamic(other);
+        small = true;
     } else {
         ptr = other.ptr;
-        ++ptr->ref_count;
+        ptr->ref_count.increment();
+        small = false;
     }
-    set_size(other.size_);
+    size_ = other.size_;
+}
+
+optimized_storage::optimized_storage(optimized_storage &&other) noexcept {
+    if (other.small) {
+        static_data = other.static_data;
+    } else {
+        ptr = other.ptr;
+    }
+    size_ = other.size_;
+    small = other.small;
+    negative_ = other.negative_;
+    other.static_data.fill(0);  ///  other stays a valid zero: one inline limb
+    other.set_size(1);
+    other.negative_ = 0;
 }
 
 optimized_storage::~optimized_storage() {
-    if (!small && ptr->ref_count == 1) {
-        delete ptr;
-    } else if (!small) {
-        --ptr->ref_count;
+    if (!small && ptr->ref_count.decrement()) {
+        shared_vector::release(ptr);
     }
 }
 
@@ -39,41 +74,70 @@ optimized_storage &optimized_storage::operator=(const optimized_storage &other)
     return *this;
 }
 
+optimized_storage &optimized_storage::operator=(optimized_storage &&other) noexcept {
+    if (this != &other) {
+        optimized_storage tmp(std::move(other));
+        swap(tmp);
+    }
+    return *this;
+}
+
 const uint32_t &optimized_storage::operator[](size_t i) const {
-    return small ? static_data[i] : ptr->data[i];
+    return small ? static_data[i] : ptr->data()[i];
 }
 
 uint32_t &optimized_storage::operator[](size_t i) {
     make_unshared();
-    return small ? static_data[i] : ptr->data[i];
+    return small ? static_data[i] : ptr->data()[i];
 }
 
 size_t optimized_storage::size() const {
     return size_;
 }
 
+bool optimized_storage::negative() const {
+    return negative_ != 0;
+}
+
+void optimized_storage::set_negative(const bool negative) {
+    negative_ = negative;
+}
+
+std::pmr::memory_resource *optimized_storage::resource() const {
+    return small ? shared_vector::default_resource() : ptr->resource;
+}
+
+const uint32_t *optimized_storage::data() const {
+    return small ? static_data.data() : ptr->data();
+}
+
+limb_span optimized_storage::span() {
+    make_unshared();
+    return {small ? static_data.data() : ptr->data(), size_};
+}
+
+const_limb_span optimized_storage::span() const {
+    return {data(), size_};
+}
+
 bool operator==(const optimized_storage &a, const optimized_storage &b) {
-    if (a.size_ != b.size_) {
-        return false;
-    }
-    for (size_t i = 0; i < a.size_; ++i) {
-        if (a[i] != b[i]) {
-            return false;
-        }
-    }
-    return true;
+    const const_limb_span a_span = a.span(), b_span = b.span();
+    return a_span.size == b_span.size && std::equal(a_span.begin(), a_span.end(), b_span.begin());
 }
 
 uint32_t optimized_storage::back() const {
-    return small ? static_data[size_ - 1] : ptr->data[size_ - 1];
+    return small ? static_data[size_ - 1] : ptr->data()[size_ - 1];
 }
 
 void optimized_storage::pop_back() {
     if (small) {
         static_data[--size_] = 0;
+    } else if (size_ - 1 <= DEMOTE_SIZE && is_default(ptr->resource)) {
+        --size_;
+        demote();
     } else {
         make_unshared();
-        ptr->data.pop_back();
+        --ptr->size;
         --size_;
     }
 }
@@ -83,17 +147,23 @@ void optimized_storage::push_back(uint32_t x) {
         static_data[size_] = x;
     } else {
         if (small) {  ///  converts from static storage to dynamic, after insertions size will be > MAX_STATIC_SIZE
-            std::vector<uint32_t> tmp(static_data.begin(), static_data.begin() + size_);
-            ptr = new shared_vector(tmp);
+            ptr = shared_vector::create(static_data.data(), size_, shared_vector::default_resource());
             small = false;
         } else {
             make_unshared();
         }
-        ptr->data.push_back(x);
+        if (ptr->size == ptr->capacity) {  ///  geometric growth keeps a series of push_back amortized O(1)
+            ptr = shared_vector::reserve(ptr, std::max(ptr->capacity * shared_vector::GROWTH_FACTOR, static_cast<size_t>(4)));
+        }
+        ptr->data()[ptr->size++] = x;
     }
     ++size_;
 }
 
+bool optimized_storage::is_default(const std::pmr::memory_resource *resource) {
+    return resource == nullptr || resource == shared_vector::default_resource();
+}
+
 void optimized_storage::set_size(size_t new_size) {
     size_ = new_size;
     small = size_ <= MAX_STATIC_SIZE;
@@ -101,19 +171,32 @@ void optimized_storage::set_size(size_t new_size) {
 
 void optimized_storage::fill_static_from_other_dynamic(const optimized_storage &other) {
     assert(other.size_ <= MAX_STATIC_SIZE);
-    std::copy(other.ptr->data.begin(), other.ptr->data.end(), static_data.begin());
+    std::copy(other.ptr->data(), other.ptr->data() + other.size_, static_data.begin());
     std::fill(static_data.begin() + other.size_, static_data.end(), 0);
 }
 
 void optimized_storage::make_unshared() {
-    if (!small && ptr->ref_count != 1) {
-        auto *tmp = new shared_vector(*ptr);
-        --ptr->ref_count;
+    if (!small && !ptr->ref_count.unique()) {
+        auto *tmp = shared_vector::create(ptr->data(), ptr->size, ptr->resource);
+        if (ptr->ref_count.decrement()) {  ///  the other owners let go while we were copying
+            shared_vector::release(ptr);
+        }
         ptr = tmp;
     }
 }
 
-void optimized_storage::swap(optimized_storage &other) {
+void optimized_storage::demote() {
+    assert(!small && size_ <= MAX_STATIC_SIZE);
+    std::array<uint32_t, MAX_STATIC_SIZE> digits{};  ///  static_data shares memory with ptr
+    std::copy(ptr->data(), ptr->data() + size_, digits.begin());
+    if (ptr->ref_count.decrement()) {
+        shared_vector::release(ptr);
+    }
+    static_data = digits;
+    small = true;
+}
+
+void optimized_storage::swap(optimized_storage &other) noexcept {
     if (small && other.small) {
         std::swap(static_data, other.static_data);
     } else if (!small && !other.small) {
@@ -127,6 +210,11 @@ void optimized_storage::swap(optimized_storage &other) {
         static_data = other.static_data;
         other.ptr = tmp_ptr;
     }
-    std::swap(small, other.small);
-    std::swap(size_, other.size_);
+    const size_t size = size_, was_small = small, was_negative = negative_;  ///  bit-fields do not bind to std::swap
+    size_ = other.size_;
+    small = other.small;
+    negative_ = other.negative_;
+    other.size_ = size;
+    other.small = was_small;
+    other.negative_ = was_negative;
 }
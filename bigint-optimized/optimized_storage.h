@@ -1,14 +1,49 @@
 #include "shared_vector.h"
+#include <cstddef>
 #include <cstdint>
 #include <array>
+#include <climits>
+#include <vector>
 
 #ifndef BIGINT_OPTIMIZED_STORAGE_H
 #define BIGINT_OPTIMIZED_STORAGE_H
 
+#ifndef BIGINT_INLINE_LIMBS
+#define BIGINT_INLINE_LIMBS (sizeof(shared_vector *) / sizeof(uint32_t))  ///  as many as the pointer's room holds
+#endif
+
+///  contiguous limbs of a storage, valid until its next resize, copy or destruction
+template<typename T>
+struct basic_limb_span {
+    T *data;
+    size_t size;
+
+    T *begin() const {
+        return data;
+    }
+
+    T *end() const {
+        return data + size;
+    }
+
+    T &operator[](size_t i) const {
+        return data[i];
+    }
+};
+
+using limb_span = basic_limb_span<uint32_t>;
+
+using const_limb_span = basic_limb_span<const uint32_t>;
+
 struct optimized_storage {
     /// @consts
 private:
-    static constexpr size_t MAX_STATIC_SIZE = sizeof(shared_vector *) / sizeof(uint32_t);  ///  optimal size
+    static constexpr size_t MAX_STATIC_SIZE = BIGINT_INLINE_LIMBS;  ///  limbs kept inline before spilling to the heap
+
+    ///  a dynamic value moves back inline only this short, so push_back and pop_back at the limit do not thrash
+    static constexpr size_t DEMOTE_SIZE = (MAX_STATIC_SIZE + 1) / 2;
+
+    static_assert(MAX_STATIC_SIZE >= 1, "BIGINT_INLINE_LIMBS must be positive");
 
     ///  @variables
 private:
@@ -17,26 +52,50 @@ private:
         std::array<uint32_t, MAX_STATIC_SIZE> static_data;  /// static storage
     };
 
-    size_t size_;  ///  number of "digits" in data
+    ///  size, inline flag and the owner's bit share one word, so with two inline limbs the storage takes 16 bytes
+    size_t size_ : sizeof(size_t) * CHAR_BIT - 2;  ///  number of "digits" in data
+
+    size_t small : 1;  ///  1, if data stores in static storage
 
-    bool small;  ///  true, if data stores in static storage
+    size_t negative_ : 1;  ///  spare bit of the owner (big_integer keeps its sign here), copied and swapped with data
 
     ///  @methods
 public:
-    explicit optimized_storage(size_t size, uint32_t val);
+    ///  resource == nullptr means shared_vector::default_resource(); with any other resource
+    ///  the limbs always live in a block from it, so the value remembers where it came from
+    explicit optimized_storage(size_t size, uint32_t val, std::pmr::memory_resource *resource = nullptr);
+
+    ///  copies digits into one block if they do not fit inline
+    explicit optimized_storage(std::vector<uint32_t> digits, std::pmr::memory_resource *resource = nullptr);
 
     optimized_storage(const optimized_storage &other);
 
+    optimized_storage(optimized_storage &&other) noexcept;  ///  takes the buffer, other becomes one inline zero limb
+
     ~optimized_storage();
 
     optimized_storage &operator=(const optimized_storage &other);
 
+    optimized_storage &operator=(optimized_storage &&other) noexcept;
+
     const uint32_t &operator[](size_t i) const;
 
     uint32_t &operator[](size_t i);
 
     size_t size() const;
 
+    bool negative() const;  ///  the owner's bit
+
+    void set_negative(bool negative);
+
+    std::pmr::memory_resource *resource() const;  ///  where the limbs come from, the default one for inline values
+
+    const uint32_t *data() const;  ///  contiguous digits, valid until the next modification
+
+    limb_span span();  ///  unshares once, so loops over the span skip per-access checks
+
+    const_limb_span span() const;
+
     friend bool operator==(const optimized_storage &a, const optimized_storage &b);
 
     uint32_t back() const;
@@ -46,13 +105,17 @@ public:
     void push_back(uint32_t x);
 
 private:
+    static bool is_default(const std::pmr::memory_resource *resource);  ///  values of the default resource may go inline
+
     void set_size(size_t new_size);  ///  updates size_ and small
 
     void fill_static_from_other_dynamic(const optimized_storage &other);  /// trying to avoid allocating dynamic memory
 
     void make_unshared();  ///  if *this shares data, then makes data unique
 
-    void swap(optimized_storage &other);
+    void demote();  ///  moves a dynamic value of at most MAX_STATIC_SIZE limbs to static storage
+
+    void swap(optimized_storage &other) noexcept;
 };
 
 bool operator==(const optimized_storage &a, const optimized_storage &b);
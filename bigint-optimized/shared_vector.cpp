@@ -1,10 +1,204 @@
 #include "shared_vector.h"
-#include <utility>
-#include <vector>
-#include <cstdint>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
 
-shared_vector::shared_vector(const size_t size, const uint32_t val) : data(size, val), ref_count(1) {}
+namespace {
+    const size_t MIN_POOLED_CLASS = 2;  ///  pooled blocks hold at least 2^2 limbs
+    const size_t MAX_POOLED_CLASS = 16;  ///  larger blocks keep their exact capacity and go straight to malloc
+    const size_t MAX_CACHED_BLOCKS = 64;  ///  per size class and thread
 
-shared_vector::shared_vector(std::vector<uint32_t> other_data) : data(std::move(other_data)), ref_count(1) {}
+    size_t block_bytes(const size_t capacity) {
+        return sizeof(shared_vector) + capacity * sizeof(uint32_t);
+    }
 
-shared_vector::shared_vector(const shared_vector &other) : data(other.data), ref_count(1) {}
+    size_t size_class(const size_t capacity) {  ///  smallest k >= MIN_POOLED_CLASS with 2^k >= capacity
+        size_t k = MIN_POOLED_CLASS;
+        while ((static_cast<size_t>(1) << k) < capacity) {
+            ++k;
+        }
+        return k;
+    }
+
+    size_t bytes_class(const size_t bytes) {  ///  smallest k >= MIN_POOLED_CLASS whose block has room for bytes
+        size_t k = MIN_POOLED_CLASS;
+        while (block_bytes(static_cast<size_t>(1) << k) < bytes) {
+            ++k;
+        }
+        return k;
+    }
+
+    struct free_block {
+        free_block *next;
+    };
+
+    ///  Blocks may be released while thread-local objects are destroyed, before or after the pool,
+    ///  so the pool state is tracked by a trivially destructible flag.
+    enum pool_state_t {
+        POOL_UNUSED, POOL_ALIVE, POOL_DESTROYED
+    };
+    thread_local pool_state_t pool_state = POOL_UNUSED;
+
+    struct block_pool {
+        free_block *heads[MAX_POOLED_CLASS + 1];
+        size_t counts[MAX_POOLED_CLASS + 1];
+        shared_vector::pool_stats stats;
+
+        block_pool() : heads(), counts(), stats() {
+            pool_state = POOL_ALIVE;
+        }
+
+        ~block_pool() {
+            trim();
+            pool_state = POOL_DESTROYED;
+        }
+
+        void *take(const size_t k) {
+            free_block *block = heads[k];
+            if (block == nullptr) {
+                ++stats.misses;
+                return nullptr;
+            }
+            heads[k] = block->next;
+            --counts[k];
+            ++stats.hits;
+            --stats.cached_blocks;
+            stats.cached_bytes -= block_bytes(static_cast<size_t>(1) << k);
+            return block;
+        }
+
+        bool put(void *memory, const size_t k) {
+            if (counts[k] == MAX_CACHED_BLOCKS) {
+                return false;
+            }
+            auto *block = static_cast<free_block *>(memory);
+            block->next = heads[k];
+            heads[k] = block;
+            ++counts[k];
+            ++stats.cached_blocks;
+            stats.cached_bytes += block_bytes(static_cast<size_t>(1) << k);
+            return true;
+        }
+
+        void trim() {
+            for (size_t k = MIN_POOLED_CLASS; k <= MAX_POOLED_CLASS; ++k) {
+                while (heads[k] != nullptr) {
+                    free_block *next = heads[k]->next;
+                    std::free(heads[k]);
+                    heads[k] = next;
+                }
+                counts[k] = 0;
+            }
+            stats.cached_blocks = stats.cached_bytes = 0;
+        }
+    };
+
+    block_pool &thread_pool() {
+        static thread_local block_pool pool;
+        return pool;
+    }
+
+    ///  Requests of a pooled size class get the whole class, so deallocate finds it again by the size.
+    class pool_resource : public std::pmr::memory_resource {
+        void *do_allocate(size_t bytes, const size_t alignment) override {
+            if (alignment > alignof(std::max_align_t)) {
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            }
+            void *memory = nullptr;
+            const size_t k = bytes_class(bytes);
+            if (k <= MAX_POOLED_CLASS) {
+                bytes = block_bytes(static_cast<size_t>(1) << k);
+                if (pool_state != POOL_DESTROYED) {
+                    memory = thread_pool().take(k);
+                }
+            }
+            if (memory == nullptr) {
+                memory = std::malloc(bytes);
+                if (memory == nullptr) {
+                    throw std::bad_alloc();
+                }
+            }
+            return memory;
+        }
+
+        void do_deallocate(void *memory, const size_t bytes, const size_t alignment) override {
+            if (alignment > alignof(std::max_align_t)) {
+                std::pmr::new_delete_resource()->deallocate(memory, bytes, alignment);
+                return;
+            }
+            const size_t k = bytes_class(bytes);
+            if (pool_state == POOL_ALIVE && k <= MAX_POOLED_CLASS && thread_pool().put(memory, k)) {
+                return;
+            }
+            std::free(memory);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+    };
+}
+
+std::pmr::memory_resource *shared_vector::default_resource() {
+    static pool_resource *const resource = new pool_resource();  ///  never destroyed, static numbers outlive it
+    return resource;
+}
+
+shared_vector *shared_vector::allocate(const size_t size, size_t capacity, std::pmr::memory_resource *resource) {
+    if (resource == default_resource() && size_class(capacity) <= MAX_POOLED_CLASS) {
+        capacity = static_cast<size_t>(1) << size_class(capacity);  ///  the class is allocated anyway
+    }
+    void *memory = resource->allocate(block_bytes(capacity), alignof(shared_vector));
+    auto *block = new(memory) shared_vector;
+    block->ref_count.reset();
+    block->size = size;
+    block->capacity = capacity;
+    block->resource = resource;
+    return block;
+}
+
+shared_vector *shared_vector::create(const size_t size, const uint32_t val, std::pmr::memory_resource *resource) {
+    shared_vector *block = allocate(size, size, resource);
+    std::fill(block->data(), block->data() + size, val);
+    return block;
+}
+
+shared_vector *shared_vector::create(const uint32_t *digits, const size_t size, std::pmr::memory_resource *resource) {
+    shared_vector *block = allocate(size, size, resource);
+    std::copy(digits, digits + size, block->data());
+    return block;
+}
+
+shared_vector *shared_vector::reserve(shared_vector *block, const size_t capacity) {
+    if (capacity <= block->capacity) {
+        return block;
+    }
+    ///  the header holds a std::atomic with BIGINT_ATOMIC_REFCOUNT, so the block is never moved
+    ///  bytewise by realloc: the limbs go to a new block with a fresh counter
+    shared_vector *grown = allocate(block->size, capacity, block->resource);
+    std::copy(block->data(), block->data() + block->size, grown->data());
+    release(block);
+    return grown;
+}
+
+void shared_vector::release(shared_vector *block) {
+    block->resource->deallocate(block, block_bytes(block->capacity), alignof(shared_vector));
+}
+
+shared_vector::pool_stats shared_vector::pool_statistics() {
+    return pool_state == POOL_ALIVE ? thread_pool().stats : pool_stats();
+}
+
+void shared_vector::trim_pool() {
+    if (pool_state == POOL_ALIVE) {
+        thread_pool().trim();
+    }
+}
+
+uint32_t *shared_vector::data() {
+    return reinterpret_cast<uint32_t *>(this + 1);
+}
+
+const uint32_t *shared_vector::data() const {
+    return reinterpret_cast<const uint32_t *>(this + 1);
+}
@@ -1,22 +1,106 @@
-#include <vector>
+#include <cstddef>
 #include <cstdint>
+#include <memory_resource>
+#ifdef BIGINT_ATOMIC_REFCOUNT
+#include <atomic>
+#endif
 
 #ifndef BIGINT_shared_vector_H
 #define BIGINT_shared_vector_H
 
+#ifdef BIGINT_ATOMIC_REFCOUNT
+///  Copies of one value may live in different threads. Dropping a reference releases the owner's
+///  writes and the uniqueness check acquires them, so the last owner may reuse or free the block.
+struct ref_counter {
+    std::atomic<size_t> count;
+
+    void reset() {
+        count.store(1, std::memory_order_relaxed);
+    }
+
+    void increment() {
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool decrement() {  ///  true for the last owner
+        return count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    bool unique() const {
+        return count.load(std::memory_order_acquire) == 1;
+    }
+};
+#else
+///  Single-threaded policy: copies of one value must not be shared between threads.
+struct ref_counter {
+    size_t count;
+
+    void reset() {
+        count = 1;
+    }
+
+    void increment() {
+        ++count;
+    }
+
+    bool decrement() {
+        return --count == 0;
+    }
+
+    bool unique() const {
+        return count == 1;
+    }
+};
+#endif
+
+///  Header of a single heap block: the limbs follow it in the same allocation, so a shared number
+///  costs one allocation and one pointer hop. Blocks are made and freed only by the static methods,
+///  through the memory resource recorded in the header.
+///  The default resource rounds capacities up to 2^16 limbs to powers of two and keeps freed blocks
+///  of those size classes in free lists of the freeing thread for the next allocation.
 struct shared_vector {
+    ///  @consts
+    static const size_t GROWTH_FACTOR = 2;  ///  push_back into a full block multiplies its capacity
+
+    ///  counters of the calling thread's free lists
+    struct pool_stats {
+        size_t hits;  ///  allocations served from a free list
+        size_t misses;  ///  allocations of a pooled size class that went to malloc
+        size_t cached_blocks;  ///  blocks waiting in the free lists
+        size_t cached_bytes;
+    };
+
     ///  @variables
 public:
-    std::vector<uint32_t> data;  ///  shared data
-    size_t ref_count;  ///  number of references on shared data
+    ref_counter ref_count;  ///  number of references on shared data, atomic with BIGINT_ATOMIC_REFCOUNT
+    size_t size;  ///  number of used limbs
+    size_t capacity;  ///  number of limbs the block has room for
+    std::pmr::memory_resource *resource;  ///  the block came from it, copies made by unsharing and growth too
 
     ///  @methods
 public:
-    explicit shared_vector(size_t size, uint32_t val);
+    static std::pmr::memory_resource *default_resource();  ///  malloc behind the thread-local free lists
+
+    static shared_vector *create(size_t size, uint32_t val, std::pmr::memory_resource *resource);
+
+    ///  copies digits, capacity >= size
+    static shared_vector *create(const uint32_t *digits, size_t size, std::pmr::memory_resource *resource);
+
+    static shared_vector *reserve(shared_vector *block, size_t capacity);  ///  pre: unique, the block may move
+
+    static void release(shared_vector *block);  ///  gives the block back to its resource
+
+    static pool_stats pool_statistics();
+
+    static void trim_pool();  ///  frees every block cached by the calling thread
+
+    uint32_t *data();
 
-    explicit shared_vector(std::vector<uint32_t> other_data);
+    const uint32_t *data() const;
 
-    shared_vector(const shared_vector &other);
+private:
+    ///  limbs are uninitialized, ref_count = 1
+    static shared_vector *allocate(size_t size, size_t capacity, std::pmr::memory_resource *resource);
 };
 
 #endif //BIGINT_shared_vector_H
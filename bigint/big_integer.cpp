@@ -1,15 +1,30 @@
 #include "big_integer.h"
+#include "limb_arithmetic.h"
+#include "limb_division.h"
+#include "decimal_digits.h"
+#include "hex_digits.h"
+#include "limb_scratch.h"
 #include <vector>
 #include <cstdint>
 #include <cmath>
 #include <stdexcept>
 #include <algorithm>
 #include <climits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <istream>
+#include <iterator>
 
 big_integer::big_integer() : data(1), sign(false) {}
 
 big_integer::big_integer(const big_integer &other) = default;
 
+big_integer::big_integer(big_integer &&other) noexcept : data(std::move(other.data)), sign(other.sign) {
+    other.data.clear();  //  other остаётся корректным нулём без выделения памяти
+    other.sign = false;
+}
+
 big_integer::big_integer(const int a) : data(1), sign(a < 0) {
     data[0] = (a == INT_MIN ? static_cast<uint32_t>(INT_MAX) + 1 : abs(a));
 }
@@ -20,14 +35,12 @@ big_integer::big_integer(const std::string &str) : big_integer() {
     if (str.empty()) {
         throw std::runtime_error("Expected: integer, found: empty string");
     }
-    big_integer base = 1;
-    for (ptrdiff_t i = str.size() - 1; i >= 0 && str[i] != '-'; --i) {
-        if (!isdigit(str[i])) {
-            throw std::runtime_error("Expected: digit, found: " + std::string(1, str[i]));
-        }
-        *this += base * static_cast<uint32_t>(str[i] - '0');
-        base *= 10;
+    const size_t begin = str[0] == '-' ? 1 : 0;
+    const size_t bad = begin + decimal::find_non_digit(str.data() + begin, str.size() - begin);
+    if (bad != str.size()) {
+        throw std::runtime_error("Expected: digit, found: " + std::string(1, str[bad]));
     }
+    *this = read_digits(str.data() + begin, str.size() - begin, 10);
     sign = (str[0] == '-');
     shrink_to_fit();
 }
@@ -36,31 +49,57 @@ big_integer::~big_integer() = default;
 
 big_integer &big_integer::operator=(const big_integer &other) = default;
 
+big_integer &big_integer::operator=(big_integer &&other) noexcept {
+    if (this != &other) {
+        data.swap(other.data);  //  старый буфер *this достаётся other
+        sign = other.sign;
+        other.data.clear();
+        other.sign = false;
+    }
+    return *this;
+}
+
+namespace {
+    const uint32_t ZERO_DIGIT = 0;
+}
+
 size_t big_integer::size() const {
-    return data.size();
+    return data.empty() ? 1 : data.size();
 }
 
 uint32_t &big_integer::operator[](const size_t i) {
-    return data[i];
+    return digits()[i];
 }
 
 const uint32_t &big_integer::operator[](const size_t i) const {
-    return data[i];
+    return digits()[i];
+}
+
+uint32_t *big_integer::digits() {
+    if (data.empty()) {
+        data.assign(1, 0);
+    }
+    return data.data();
+}
+
+const uint32_t *big_integer::digits() const {
+    return data.empty() ? &ZERO_DIGIT : data.data();
 }
 
 uint32_t big_integer::get_kth(const size_t k) const {
-    return (k < size() ? data[k] : 0);
+    return (k < size() ? digits()[k] : 0);
 }
 
 void big_integer::fill_back(const size_t n, const uint32_t value) {
+    digits();  //  пустой data сначала становится одним нулевым разрядом
     data.insert(data.end(), n, value);
 }
 
-uint32_t big_integer::low32_bits(const uint64_t a) {
-    return static_cast<uint32_t>(UINT32_MAX & a);
+void big_integer::replace_digits(const uint32_t *src, const size_t n) {
+    data.assign(src, src + n);
 }
 
-uint32_t big_integer::low32_bits(const uint128_t a) {
+uint32_t big_integer::low32_bits(const uint64_t a) {
     return static_cast<uint32_t>(UINT32_MAX & a);
 }
 
@@ -74,15 +113,11 @@ big_integer &big_integer::operator+=(const big_integer &rhs) {
     } else if (!sign && rhs.sign) {
         return *this -= -rhs;
     }  //  свел задачу к a + b, где a и b одного знака
-    bool carry = false;
     if (rhs.size() > size()) {
         fill_back(rhs.size() - size(), 0);
     }
-    for (size_t i = 0; i < size(); ++i) {
-        const auto sum = static_cast<uint64_t>(data[i]) + rhs.get_kth(i) + carry;
-        data[i] = low32_bits(sum);
-        carry = high32_bits(sum);
-    }
+    uint32_t *r = digits();
+    const uint32_t carry = limbs::add(r, r, size(), rhs.digits(), rhs.size());
     if (carry) {
         fill_back(1, carry);
     }
@@ -99,12 +134,8 @@ big_integer &big_integer::operator-=(const big_integer &rhs) {
     } else if (*this < rhs) {
         return *this = -(rhs - *this);
     }  //  свел задачу к a - b, где a >= 0, b >= 0, a >= b
-    bool borrow = false;
-    for (size_t i = 0; i < rhs.size() || borrow; ++i) {
-        const auto sub = static_cast<int64_t>(data[i]) - rhs.get_kth(i) - borrow;
-        borrow = sub < 0;
-        data[i] = static_cast<uint32_t>(sub + (borrow ? BASE : 0));
-    }
+    uint32_t *r = digits();
+    limbs::sub(r, r, size(), rhs.digits(), rhs.size());
     shrink_to_fit();
     return *this;
 }
@@ -141,133 +172,198 @@ big_integer &big_integer::operator*=(const big_integer &rhs) {
     } else if (!rhs.sign && rhs.count() == 1) {
         return *this <<= rhs.clear_log2();
     }
-    big_integer ans;
-    ans.sign = sign ^ rhs.sign;
-    ans.fill_back(size() + rhs.size(), 0);
-    for (size_t i = 0; i < size(); ++i) {
-        uint32_t carry = 0;
-        for (size_t j = 0; j < rhs.size() || carry; ++j) {
-            const auto additive = static_cast<uint64_t>(data[i]) * rhs.get_kth(j) + carry + ans[i + j];
-            ans[i + j] = low32_bits(additive);
-            carry = high32_bits(additive);
-        }
+    limbs::scratch_buffer product(size() + rhs.size());  //  произведение копируется в буфер *this
+    if (this == &rhs) {  //  a *= a и a * a, у копий в std::vector свои буферы
+        limbs::sqr(product.data(), digits(), size());
+    } else {
+        limbs::mul(product.data(), digits(), size(), rhs.digits(), rhs.size());
     }
-    ans.shrink_to_fit();
-    return *this = ans;
+    const bool negative = sign ^ rhs.sign;
+    replace_digits(product.data(), product.size());
+    sign = negative;
+    shrink_to_fit();
+    return *this;
 }
 
 std::pair<big_integer, uint32_t> big_integer::short_div(const big_integer &a, const uint32_t b) {
     if (b == 0) {
         throw std::runtime_error("Division by zero");
     }
-    uint64_t carry = 0;
-    big_integer ans(a);
-    for (ptrdiff_t i = ans.size() - 1; i >= 0; --i) {
-        const auto dividend = static_cast<uint64_t>(ans[i]) + carry * BASE;
-        ans[i] = low32_bits(dividend / b);
-        carry = dividend % b;
-    }
+    std::vector<uint32_t> quotient(a.size());
+    const uint32_t remainder = limbs::divrem_1(quotient.data(), a.digits(), a.size(), b);
+    big_integer ans;
+    ans.sign = a.sign;
+    ans.data = std::move(quotient);
     ans.shrink_to_fit();
-    return {ans, carry};
+    return {ans, remainder};
 }
 
-uint32_t big_integer::trial(const uint64_t k, const uint64_t m, const big_integer &d) const {
-    const auto r3 = (static_cast<uint128_t>(data[k + m]) * BASE + data[k + m - 1]) * BASE + data[k + m - 2];
-    const uint64_t d2 = (static_cast<uint64_t>(d[m - 1]) << 32u) + d[m - 2];
-    return low32_bits(std::min(r3 / d2, static_cast<uint128_t>(BASE - 1)));
-}
-
-bool big_integer::smaller(const big_integer &dq, const uint64_t k, const uint64_t m) const {
-    uint64_t i = m, j = 0;
-    while (i != j) {
-        data[i + k] == dq[i] ? --i : j = i;
-    }
-    return data[i + k] < dq[i];
-}
-
-void big_integer::difference(const big_integer &dq, const uint64_t k, const uint64_t m) {
-    uint64_t borrow = 0;
-    for (size_t i = 0; i <= m; ++i) {
-        const uint64_t diff = static_cast<uint64_t>(data[i + k]) - dq[i] - borrow + BASE;
-        data[i + k] = low32_bits(diff);
-        borrow = 1 - high32_bits(diff);
+uint32_t big_integer::shift_digits(uint32_t *dst, const uint32_t *src, const size_t n, const uint32_t shift) {
+    if (shift == 0) {
+        std::copy(src, src + n, dst);
+        return 0;
     }
+    return limbs::lshift(dst, src, n, shift);
 }
 
 big_integer &big_integer::operator/=(const big_integer &rhs) {
     if (size() < rhs.size()) {
         return *this = 0;
     } else if (rhs.size() == 1) {
-        const auto ans = big_integer::short_div(*this, rhs[0]);
-        return *this = rhs.sign ? -ans.first : ans.first;
-    } else if (!rhs.sign && rhs.count() == 1) {
+        if (rhs[0] == 0) {
+            throw std::runtime_error("Division by zero");
+        }
+        limbs::divrem_1(digits(), digits(), size(), rhs[0]);
+        sign ^= rhs.sign;
+        shrink_to_fit();
+        return *this;
+    } else if (!sign && !rhs.sign && rhs.count() == 1) {
         return *this >>= rhs.clear_log2();
     }
-    const size_t n = size(), m = rhs.size();
-    const uint64_t f = BASE / (static_cast<uint64_t>(rhs[m - 1]) + 1);
-    big_integer q, r = (*this) * f, d = rhs * f;
-    q.sign = sign ^ rhs.sign;
-    q.fill_back(n - m + 1, 0);
-    r.sign = d.sign = false;
-    r.fill_back(1, 0);
-    for (ptrdiff_t k = n - m; k >= 0; --k) {
-        uint32_t qt = r.trial(static_cast<uint64_t>(k), m, d);
-        auto dq = big_integer(qt) * d;
-        dq.fill_back(m + 1, 0);
-        if (r.smaller(dq, static_cast<uint64_t>(k), m)) {
-            qt--;
-            dq = d * qt;
-        }
-        q[k] = qt;
-        r.difference(dq, static_cast<uint64_t>(k), m);
+    limbs::scratch_buffer d(rhs.size());
+    const uint32_t shift = normalize(d.data(), rhs);
+    return divide_in_place(d.data(), rhs.size(), shift, nullptr, rhs.sign, false);
+}
+
+uint32_t big_integer::normalize(uint32_t *dst, const big_integer &b) {
+    const size_t m = b.size();
+    const auto shift = static_cast<uint32_t>(__builtin_clz(b[m - 1]));
+    shift_digits(dst, b.digits(), m, shift);
+    return shift;
+}
+
+void big_integer::divide(uint32_t *quotient, uint32_t *remainder, const big_integer &a,
+                         const uint32_t *d, const size_t m, const uint32_t shift, const uint32_t *inverse) {
+    const size_t n = a.size();
+    limbs::scratch_buffer u(n + 1);  //  нормализованное делимое, n + 1 разрядов
+    u[n] = shift_digits(u.data(), a.digits(), n, shift);
+    if (inverse != nullptr && 2 * (n + 1 - m) >= m) {  //  короткое частное выгоднее делить без обратного
+        limbs::div_qr_preinv(quotient, u.data(), n + 1, d, m, inverse);
+    } else {
+        limbs::div_qr(quotient, u.data(), n + 1, d, m);  //  u[n] < d[m - 1], старший разряд частного всегда 0
+    }
+    if (shift == 0) {
+        std::copy(u.data(), u.data() + m, remainder);
+    } else {
+        limbs::rshift(remainder, u.data(), m, shift);
+    }
+}
+
+std::pair<big_integer, big_integer> big_integer::long_div(const big_integer &a, const uint32_t *d, const size_t m,
+                                                          const uint32_t shift, const uint32_t *inverse,
+                                                          const bool negative) {
+    const size_t n = a.size();
+    std::vector<uint32_t> quotient(n - m + 1), remainder(m);
+    divide(quotient.data(), remainder.data(), a, d, m, shift, inverse);
+    std::pair<big_integer, big_integer> ans;
+    ans.first.sign = a.sign ^ negative;
+    ans.first.data = std::move(quotient);
+    ans.first.shrink_to_fit();
+    ans.second.sign = a.sign;
+    ans.second.data = std::move(remainder);
+    ans.second.shrink_to_fit();
+    return ans;
+}
+
+big_integer &big_integer::divide_in_place(const uint32_t *d, const size_t m, const uint32_t shift,
+                                          const uint32_t *inverse, const bool negative, const bool remainder) {
+    const size_t n = size();
+    limbs::scratch_buffer q(n - m + 1), r(m);
+    divide(q.data(), r.data(), *this, d, m, shift, inverse);
+    if (remainder) {
+        replace_digits(r.data(), m);  //  знак остатка - знак делимого
+    } else {
+        replace_digits(q.data(), n - m + 1);
+        sign ^= negative;
+    }
+    shrink_to_fit();
+    return *this;
+}
+
+big_integer::divisor::divisor(const big_integer &value) : value(value), shift(0) {
+    const size_t m = value.size();
+    if (m < 2) {
+        return;
+    }
+    normalized.resize(m);
+    shift = normalize(normalized.data(), value);
+    if (m >= limbs::newton_threshold) {
+        inverse.resize(m + 1);
+        limbs::invert(inverse.data(), normalized.data(), m);
     }
-    q.shrink_to_fit();
-    return *this = q;
+}
+
+big_integer &big_integer::operator/=(const divisor &rhs) {
+    const size_t m = rhs.normalized.size();
+    if (m == 0) {
+        return *this /= rhs.value;
+    } else if (size() < m) {
+        return *this = 0;
+    }
+    return divide_in_place(rhs.normalized.data(), m, rhs.shift, rhs.inverse.empty() ? nullptr : rhs.inverse.data(),
+                           rhs.value.sign, false);
 }
 
 big_integer &big_integer::operator%=(const big_integer &rhs) {
-    return *this -= (*this / rhs) * rhs;
+    if (size() < rhs.size()) {
+        return *this;
+    } else if (rhs.size() == 1) {
+        if (rhs[0] == 0) {
+            throw std::runtime_error("Division by zero");
+        }
+        const uint32_t remainder = limbs::divrem_1(digits(), digits(), size(), rhs[0]);
+        replace_digits(&remainder, 1);
+        shrink_to_fit();
+        return *this;
+    }
+    limbs::scratch_buffer d(rhs.size());
+    const uint32_t shift = normalize(d.data(), rhs);
+    return divide_in_place(d.data(), rhs.size(), shift, nullptr, rhs.sign, true);
 }
 
 void big_integer::to_additional_code(const size_t n_digits) {
     fill_back(n_digits - size(), 0);
     if (sign) {
         sign = false;
-        for (uint32_t &digit : data) {
-            digit = ~digit;
+        if (limbs::neg(digits(), digits(), size()) == 0) {  //  нулевые разряды со знаком минус означают -B^n
+            data.push_back(1);
         }
-        *this += 1;
     }
 }
 
-big_integer &
-big_integer::bitwise_operation(const big_integer &rhs, const func &f) {
-    big_integer ans(*this), tmp_rhs(rhs);
+template<typename Operation>
+big_integer &big_integer::bitwise_operation(const big_integer &rhs, Operation f) {
     const size_t max_size = std::max(size(), rhs.size());
-    ans.to_additional_code(max_size);
-    tmp_rhs.to_additional_code(max_size);
-    ans.sign = f(sign, rhs.sign);
+    limbs::scratch_buffer b(max_size, 0);  //  rhs в дополнительном коде, копируется до изменения *this
+    std::copy(rhs.digits(), rhs.digits() + rhs.size(), b.data());
+    if (rhs.sign) {
+        limbs::neg(b.data(), b.data(), max_size);
+    }
+    const bool negative = f(sign, rhs.sign);
+    to_additional_code(max_size);
+    uint32_t *r = digits();
     for (size_t i = 0; i < max_size; ++i) {
-        ans[i] = f(ans[i], tmp_rhs[i]);
+        r[i] = f(r[i], b[i]);
     }
-    if (ans.sign) {
-        ans.to_additional_code(max_size);
-        ans.sign = true;
+    sign = negative;
+    if (negative) {
+        to_additional_code(max_size);
+        sign = true;
     }
-    ans.shrink_to_fit();
-    return *this = ans;
+    shrink_to_fit();
+    return *this;
 }
 
 big_integer &big_integer::operator&=(const big_integer &rhs) {
-    return *this = bitwise_operation(rhs, [](uint32_t a, uint32_t b) { return a & b; });
+    return bitwise_operation(rhs, [](uint32_t a, uint32_t b) { return a & b; });
 }
 
 big_integer &big_integer::operator|=(const big_integer &rhs) {
-    return *this = bitwise_operation(rhs, [](uint32_t a, uint32_t b) { return a | b; });
+    return bitwise_operation(rhs, [](uint32_t a, uint32_t b) { return a | b; });
 }
 
 big_integer &big_integer::operator^=(const big_integer &rhs) {
-    return *this = bitwise_operation(rhs, [](uint32_t a, uint32_t b) { return a ^ b; });
+    return bitwise_operation(rhs, [](uint32_t a, uint32_t b) { return a ^ b; });
 }
 
 big_integer &big_integer::operator<<=(const int b) {
@@ -275,18 +371,18 @@ big_integer &big_integer::operator<<=(const int b) {
         return *this >>= (-b);
     }
     const auto n_added = static_cast<size_t>(b / 32);
+    const size_t n = size();
     fill_back(n_added, 0);
-    for (ptrdiff_t i = size() - n_added - 1; i >= 0; --i) {
-        std::swap(data[i + n_added], data[i]);
-    }
+    uint32_t *r = digits();
+    std::copy_backward(r, r + n, r + n + n_added);
+    std::fill(r, r + n_added, 0);
     const auto shift = static_cast<uint32_t>(b % 32);
-    uint64_t carry = 0;
-    for (size_t i = n_added; i < size(); ++i) {
-        const uint64_t tmp = (static_cast<uint64_t>(data[i]) << shift) | carry;
-        data[i] = low32_bits(tmp);
-        carry = high32_bits(tmp);
+    if (shift != 0) {
+        const uint32_t carry = limbs::lshift(r + n_added, r + n_added, n, shift);
+        if (carry) {
+            fill_back(1, carry);
+        }
     }
-    fill_back(1, carry);
     shrink_to_fit();
     return *this;
 }
@@ -296,21 +392,23 @@ big_integer &big_integer::operator>>=(const int b) {
         return *this <<= (-b);
     }
     const auto n_deleted = static_cast<size_t>(b / 32);
-    for (size_t i = 0; i < size() - n_deleted; ++i) {
-        data[i] = data[i + n_deleted];
+    if (n_deleted >= size()) {  //  отрицательное число округляется вниз, до -1
+        return *this = sign ? -1 : 0;
     }
+    const bool negative = sign;  //  shrink_to_fit сбрасывает знак у нуля
+    uint32_t *r = digits();
+    //  отрицательное число округляется вниз, только если отброшен ненулевой бит
+    bool inexact = std::any_of(r, r + n_deleted, [](uint32_t x) { return x != 0; });
+    std::copy(r + n_deleted, r + size(), r);
     for (size_t i = 0; i < n_deleted; ++i) {
         data.pop_back();
     }
     const auto shift = static_cast<uint32_t>(b % 32);
-    uint32_t carry = 0;
-    for (ptrdiff_t i = size() - 1; i >= 0; --i) {
-        const auto tmp = static_cast<uint64_t>(data[i]) << (32 - shift);
-        data[i] = high32_bits(tmp) | carry;
-        carry = low32_bits(tmp);
+    if (shift != 0) {
+        inexact |= limbs::rshift(digits(), digits(), size(), shift) != 0;
     }
     shrink_to_fit();
-    return sign ? --(*this) : (*this);
+    return negative && inexact ? --(*this) : (*this);
 }
 
 big_integer big_integer::operator+() const {
@@ -350,47 +448,79 @@ big_integer big_integer::operator--(int) {
 }
 
 big_integer operator+(big_integer a, const big_integer &b) {
-    return a += b;
+    return std::move(a += b);
+}
+
+big_integer operator+(const big_integer &a, big_integer &&b) {
+    return std::move(b += a);
 }
 
 big_integer operator-(big_integer a, const big_integer &b) {
-    return a -= b;
+    return std::move(a -= b);
+}
+
+big_integer operator-(const big_integer &a, big_integer &&b) {  //  a - b = -(b - a)
+    b -= a;
+    if (b != 0) {
+        b.sign ^= true;
+    }
+    return std::move(b);
 }
 
 big_integer operator*(big_integer a, const big_integer &b) {
-    return a *= b;
+    return std::move(a *= b);
+}
+
+big_integer operator*(const big_integer &a, big_integer &&b) {
+    return std::move(b *= a);
 }
 
 big_integer operator/(big_integer a, const big_integer &b) {
-    return a /= b;
+    return std::move(a /= b);
+}
+
+big_integer operator/(big_integer a, const big_integer::divisor &b) {
+    return std::move(a /= b);
 }
 
 big_integer operator%(big_integer a, const big_integer &b) {
-    return a %= b;
+    return std::move(a %= b);
 }
 
 big_integer operator&(big_integer a, const big_integer &b) {
-    return a &= b;
+    return std::move(a &= b);
+}
+
+big_integer operator&(const big_integer &a, big_integer &&b) {
+    return std::move(b &= a);
 }
 
 big_integer operator|(big_integer a, const big_integer &b) {
-    return a |= b;
+    return std::move(a |= b);
+}
+
+big_integer operator|(const big_integer &a, big_integer &&b) {
+    return std::move(b |= a);
 }
 
 big_integer operator^(big_integer a, const big_integer &b) {
-    return a ^= b;
+    return std::move(a ^= b);
+}
+
+big_integer operator^(const big_integer &a, big_integer &&b) {
+    return std::move(b ^= a);
 }
 
 big_integer operator<<(big_integer a, const int b) {
-    return a <<= b;
+    return std::move(a <<= b);
 }
 
 big_integer operator>>(big_integer a, const int b) {
-    return a >>= b;
+    return std::move(a >>= b);
 }
 
 bool operator==(const big_integer &a, const big_integer &b) {
-    return (a.sign == b.sign && a.data == b.data);
+    return (a.sign == b.sign && a.size() == b.size() && std::equal(a.digits(), a.digits() + a.size(), b.digits()));
 }
 
 bool operator!=(const big_integer &a, const big_integer &b) {
@@ -424,30 +554,484 @@ bool operator>=(const big_integer &a, const big_integer &b) {
     return !(a < b);
 }
 
+namespace {
+    const char DIGIT_CHARS[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+    uint32_t digit_value(const char c) {  //  36 для символов, не являющихся цифрами ни в какой системе
+        if ('0' <= c && c <= '9') {
+            return static_cast<uint32_t>(c - '0');
+        } else if ('a' <= c && c <= 'z') {
+            return static_cast<uint32_t>(c - 'a' + 10);
+        } else if ('A' <= c && c <= 'Z') {
+            return static_cast<uint32_t>(c - 'A' + 10);
+        }
+        return 36;
+    }
+
+    void mul_add_1(std::vector<uint32_t> &value, const uint32_t m, const uint32_t a) {  //  value = value * m + a
+        uint32_t high = limbs::mul_1(value.data(), value.data(), value.size(), m);
+        high += limbs::add_1(value.data(), value.data(), value.size(), a);
+        if (high != 0) {
+            value.push_back(high);
+        }
+    }
+}
+
+big_integer big_integer::from_limbs(std::vector<uint32_t> value) {
+    big_integer ans;
+    if (!value.empty()) {
+        ans.data = std::move(value);
+        ans.shrink_to_fit();
+    }
+    return ans;
+}
+
+std::pair<uint32_t, size_t> big_integer::radix_chunk(const int base) {
+    uint64_t power = static_cast<uint64_t>(base);
+    size_t digits = 1;
+    while (power * base < BASE) {
+        power *= base;
+        ++digits;
+    }
+    return {static_cast<uint32_t>(power), digits};
+}
+
+namespace {
+    std::mutex radix_mutex;
+    std::vector<std::shared_ptr<const big_integer::divisor>> radix_powers[37];
+}
+
+std::shared_ptr<const big_integer::divisor> big_integer::radix_power(const int base, const size_t k) {
+    std::unique_lock<std::mutex> lock(radix_mutex);
+    std::vector<std::shared_ptr<const divisor>> &table = radix_powers[base];
+    while (table.size() <= k) {
+        //  квадрат и обратное считаются без блокировки, чтобы не останавливать другие потоки
+        const size_t level = table.size();
+        const std::shared_ptr<const divisor> previous = level == 0 ? nullptr : table.back();
+        lock.unlock();
+        auto next = std::make_shared<const divisor>(previous ? previous->value * previous->value
+                                                             : big_integer(radix_chunk(base).first));
+        lock.lock();
+        if (table.size() == level) {  //  иначе другой поток уже добавил эту степень или очистил таблицу
+            table.push_back(std::move(next));
+        }
+    }
+    return table[k];
+}
+
+size_t big_integer::radix_cache_bytes() {
+    std::lock_guard<std::mutex> lock(radix_mutex);
+    size_t bytes = 0;
+    for (const auto &table : radix_powers) {
+        for (const auto &power : table) {
+            bytes += (power->value.size() + power->normalized.size() + power->inverse.size()) * sizeof(uint32_t);
+        }
+    }
+    return bytes;
+}
+
+void big_integer::trim_radix_cache() {
+    std::lock_guard<std::mutex> lock(radix_mutex);
+    for (auto &table : radix_powers) {
+        table.clear();
+    }
+}
+
+big_integer big_integer::read_digits(const char *digits, const size_t n, const int base) {
+    const std::pair<uint32_t, size_t> chunk = radix_chunk(base);
+    if (n >= PARSE_SPLIT_THRESHOLD) {
+        //  старшие цифры умножаются на base^(c * 2^k), младших ровно c * 2^k, не меньше половины
+        size_t k = 0;
+        while ((chunk.second << (k + 1)) < n) {
+            ++k;
+        }
+        const size_t low_digits = chunk.second << k;
+        big_integer ans = read_digits(digits, n - low_digits, base);
+        ans *= radix_power(base, k)->value;
+        return ans += read_digits(digits + n - low_digits, low_digits, base);
+    }
+    //  по c цифр: value = value * base^c + piece, первый кусок короче
+    std::vector<uint32_t> value;
+    size_t length = n % chunk.second == 0 ? chunk.second : n % chunk.second;
+    for (size_t i = 0; i < n; i += length, length = chunk.second) {
+        uint32_t piece = 0;
+        if (base == 10) {
+            piece = decimal::parse(digits + i, length);
+        } else {
+            for (size_t j = i; j < i + length; ++j) {
+                piece = piece * base + digit_value(digits[j]);
+            }
+        }
+        mul_add_1(value, chunk.first, piece);
+    }
+    return from_limbs(std::move(value));
+}
+
+char *big_integer::write_digits(char *out, char *last, const big_integer &a, const size_t width, const int base) {
+    const std::pair<uint32_t, size_t> chunk = radix_chunk(base);
+    size_t n = a.size();
+    if (n < DIGITS_SPLIT_THRESHOLD) {  //  по c цифр делением на base^c, в буферах на стеке
+        uint32_t rest[DIGITS_SPLIT_THRESHOLD];
+        char reversed[DIGITS_SPLIT_THRESHOLD * 32];
+        std::copy(a.digits(), a.digits() + n, rest);
+        size_t length = 0;
+        while (n != 0 && rest[n - 1] == 0) {
+            --n;
+        }
+        while (n != 0) {
+            uint32_t piece = limbs::divrem_1(rest, rest, n, chunk.first);
+            for (size_t i = 0; i < chunk.second; ++i, piece /= base) {
+                reversed[length++] = DIGIT_CHARS[piece % base];
+            }
+            while (n != 0 && rest[n - 1] == 0) {
+                --n;
+            }
+        }
+        while (length != 0 && reversed[length - 1] == '0') {
+            --length;
+        }
+        if (static_cast<size_t>(last - out) < std::max(width, length)) {
+            return nullptr;
+        }
+        out = std::fill_n(out, width > length ? width - length : 0, '0');
+        return std::reverse_copy(reversed, reversed + length, out);
+    }
+    //  |a| = q * base^(c * 2^k) + r, степень около корня из a; r дополняется нулями до c * 2^k цифр
+    size_t k = 0;
+    while (2 * radix_power(base, k + 1)->value.size() <= n + 1) {
+        ++k;
+    }
+    const size_t low_width = chunk.second << k;
+    const auto division = divmod(a, *radix_power(base, k));
+    out = write_digits(out, last, division.first, width > low_width ? width - low_width : 0, base);
+    return out == nullptr ? nullptr : write_digits(out, last, division.second, low_width, base);
+}
+
+bool big_integer::write_digits(std::streambuf &out, const big_integer &a, const size_t width, const int base) {
+    if (a.size() < DIGITS_SPLIT_THRESHOLD) {
+        char block[DIGITS_SPLIT_THRESHOLD * 32];
+        const auto length = static_cast<size_t>(write_digits(block, std::end(block), a, 0, base) - block);
+        for (size_t zeros = width > length ? width - length : 0; zeros != 0; --zeros) {
+            if (out.sputc('0') == std::char_traits<char>::eof()) {
+                return false;
+            }
+        }
+        return out.sputn(block, static_cast<std::streamsize>(length)) == static_cast<std::streamsize>(length);
+    }
+    size_t k = 0;
+    while (2 * radix_power(base, k + 1)->value.size() <= a.size() + 1) {
+        ++k;
+    }
+    const size_t low_width = radix_chunk(base).second << k;
+    std::pair<big_integer, big_integer> division = divmod(a, *radix_power(base, k));
+    if (!write_digits(out, division.first, width > low_width ? width - low_width : 0, base)) {
+        return false;
+    }
+    division.first = big_integer();  //  старшие цифры уже в потоке, держим в памяти только остаток
+    return write_digits(out, division.second, low_width, base);
+}
+
+char *big_integer::write_pow2(char *out, const big_integer &a, const unsigned digit_bits) {
+    const size_t n = a.size();
+    const size_t bits = 32 * n - static_cast<size_t>(__builtin_clz(a[n - 1]));
+    if (digit_bits == 4) {  //  старший разряд без ведущих нулей, остальные по 8 цифр
+        for (size_t i = (bits - 32 * (n - 1) + 3) / 4; i-- != 0;) {
+            *out++ = DIGIT_CHARS[a[n - 1] >> (4 * i) & 0xFu];
+        }
+        hex::write(out, a.digits(), n - 1);
+        return out + 8 * (n - 1);
+    }
+    const uint32_t mask = (1u << digit_bits) - 1;
+    for (size_t i = (bits + digit_bits - 1) / digit_bits; i-- != 0;) {  //  цифра может лежать в двух разрядах
+        const size_t position = i * digit_bits;
+        uint64_t window = a[position / 32];
+        if (position / 32 + 1 < n) {
+            window |= static_cast<uint64_t>(a[position / 32 + 1]) << 32u;
+        }
+        *out++ = DIGIT_CHARS[window >> (position % 32) & mask];
+    }
+    return out;
+}
+
+big_integer big_integer::read_pow2(const char *digits, const size_t n, const unsigned digit_bits) {
+    std::vector<uint32_t> value((n * digit_bits + 31) / 32, 0);
+    size_t position = 0;
+    for (size_t i = n; i-- != 0; position += digit_bits) {
+        const uint64_t digit = static_cast<uint64_t>(digit_value(digits[i])) << (position % 32);
+        value[position / 32] |= static_cast<uint32_t>(digit);
+        if (digit >> 32u != 0) {
+            value[position / 32 + 1] |= static_cast<uint32_t>(digit >> 32u);
+        }
+    }
+    return from_limbs(std::move(value));
+}
+
+big_integer::parser::parser(const int base)
+        : base(base), chunk(radix_chunk(base)), started(false), negative(false), piece(0), piece_digits(0),
+          block_chunks(0) {}
+
+size_t big_integer::parser::feed(const char *s, const size_t n) {
+    size_t i = 0;
+    if (n != 0 && !started && s[0] == '-') {
+        negative = true;
+        i = 1;
+    }
+    for (; i < n; ++i) {
+        const uint32_t digit = digit_value(s[i]);
+        if (digit >= static_cast<uint32_t>(base)) {
+            break;
+        }
+        piece = piece * base + digit;
+        if (++piece_digits == chunk.second) {
+            mul_add_1(block, chunk.first, piece);
+            piece = 0;
+            piece_digits = 0;
+            if (++block_chunks == size_t(1) << BLOCK_LEVEL) {
+                push_block();
+            }
+        }
+    }
+    started = started || i != 0;
+    return i;
+}
+
+bool big_integer::parser::empty() const {
+    return levels.empty() && block_chunks == 0 && piece_digits == 0;
+}
+
+void big_integer::parser::push_block() {
+    big_integer value = from_limbs(std::move(block));
+    block.clear();
+    block_chunks = 0;
+    size_t level = 0;
+    for (; !levels.empty() && levels.back().second == level; ++level) {  //  два блока уровня l дают блок уровня l + 1
+        big_integer high = std::move(levels.back().first);
+        levels.pop_back();
+        high *= radix_power(base, BLOCK_LEVEL + level)->value;
+        value = std::move(high += value);
+    }
+    levels.emplace_back(std::move(value), level);
+}
+
+big_integer big_integer::parser::finish() {
+    if (empty()) {
+        throw std::runtime_error("Expected: digit, found: end of input");
+    }
+    //  хвост из неполного блока и куска короче блока, base^(длина хвоста) собирается там же
+    std::vector<uint32_t> power(1, 1);
+    for (size_t i = 0; i < block_chunks; ++i) {
+        mul_add_1(power, chunk.first, 0);
+    }
+    uint32_t piece_power = 1;
+    for (size_t i = 0; i < piece_digits; ++i) {
+        piece_power *= base;
+    }
+    mul_add_1(power, piece_power, 0);
+    mul_add_1(block, piece_power, piece);
+    big_integer ans;
+    for (const std::pair<big_integer, size_t> &level : levels) {
+        ans *= radix_power(base, BLOCK_LEVEL + level.second)->value;
+        ans += level.first;
+    }
+    ans *= from_limbs(std::move(power));
+    ans += from_limbs(std::move(block));
+    if (negative) {
+        ans.sign = true;
+        ans.shrink_to_fit();
+    }
+    *this = parser(base);
+    return ans;
+}
+
 std::string to_string(const big_integer &a) {
-    if (a == 0) {
-        return "0";
+    std::string str(to_chars_size(a, 10), '0');
+    str.resize(static_cast<size_t>(to_chars(&str[0], &str[0] + str.size(), a, 10).ptr - &str[0]));
+    return str;
+}
+
+size_t to_chars_size(const big_integer &a, const int base) {
+    if (base < 2 || base > 36) {
+        return 0;
     }
-    std::string str;
-    big_integer tmp(a);
-    while (tmp != 0) {
-        const auto division = big_integer::short_div(tmp, 10);
-        str += static_cast<char>('0' + division.second);
-        tmp = division.first;
+    const size_t bits = 32 * a.size() - static_cast<size_t>(__builtin_clz(a[a.size() - 1] | 1u));
+    size_t digits;
+    if ((base & (base - 1)) == 0) {
+        const auto digit_bits = static_cast<size_t>(__builtin_ctz(static_cast<uint32_t>(base)));
+        digits = (bits + digit_bits - 1) / digit_bits;
+    } else {  //  floor(bits * log_base(2)) + 1 и запас на погрешность логарифма
+        digits = static_cast<size_t>(static_cast<double>(bits) * std::log(2.0) / std::log(base)) + 2;
+    }
+    return digits + (a.sign ? 1 : 0);
+}
+
+to_chars_result to_chars(char *first, char *last, const big_integer &a, const int base) {
+    if (base < 2 || base > 36) {
+        return {last, std::errc::invalid_argument};
+    }
+    const auto room = static_cast<size_t>(last - first);
+    const size_t bound = to_chars_size(a, base);
+    const bool pow2 = (base & (base - 1)) == 0;
+    //  для степеней двойки граница точна, иначе длиннее записи не более чем на 2 символа
+    if (room < (pow2 ? bound : std::max(bound, static_cast<size_t>(2)) - 2) || room == 0) {
+        return {last, std::errc::value_too_large};
     }
     if (a.sign) {
-        str += '-';
+        *first++ = '-';
+    }
+    if (a.size() == 1 && a[0] == 0) {
+        *first++ = '0';
+        return {first, std::errc()};
+    }
+    if (pow2) {
+        return {big_integer::write_pow2(first, a, static_cast<unsigned>(__builtin_ctz(static_cast<uint32_t>(base)))),
+                std::errc()};
+    }
+    char *end = big_integer::write_digits(first, last, a, 0, base);  //  длину проверяет старший кусок
+    if (end == nullptr) {
+        return {last, std::errc::value_too_large};
+    }
+    return {end, std::errc()};
+}
+
+from_chars_result from_chars(const char *first, const char *last, big_integer &a, int base) {
+    if (base == 1 || base < 0 || base > 36) {
+        return {first, std::errc::invalid_argument};
+    }
+    const bool negative = first != last && *first == '-';
+    const char *begin = first + (negative ? 1 : 0), *end = begin;
+    if (base == 0) {  //  префикс учитывается, только если за ним есть цифра
+        base = 10;
+        if (last - begin >= 2 && begin[0] == '0') {
+            const char c = begin[1];
+            const int prefixed = c == 'x' || c == 'X' ? 16 : c == 'b' || c == 'B' ? 2 : 8;
+            const char *digits = begin + (prefixed == 8 ? 1 : 2);
+            if (digits != last && digit_value(*digits) < static_cast<uint32_t>(prefixed)) {
+                base = prefixed;
+                begin = end = digits;
+            }
+        }
+    }
+    if (base == 10) {
+        end += decimal::find_non_digit(begin, static_cast<size_t>(last - begin));
+    } else {
+        while (end != last && digit_value(*end) < static_cast<uint32_t>(base)) {
+            ++end;
+        }
+    }
+    if (begin == end) {
+        return {first, std::errc::invalid_argument};
+    }
+    if ((base & (base - 1)) == 0) {
+        a = big_integer::read_pow2(begin, static_cast<size_t>(end - begin),
+                                   static_cast<unsigned>(__builtin_ctz(static_cast<uint32_t>(base))));
+    } else {
+        a = big_integer::read_digits(begin, static_cast<size_t>(end - begin), base);
+    }
+    a.sign = negative;
+    a.shrink_to_fit();
+    return {end, std::errc()};
+}
+
+std::pair<big_integer, big_integer> divmod(const big_integer &a, const big_integer &b) {
+    if (a.size() < b.size()) {
+        return {big_integer(), a};
+    } else if (b.size() == 1) {
+        const auto division = big_integer::short_div(a, b[0]);
+        big_integer remainder(division.second);
+        remainder.sign = a.sign && division.second != 0;
+        return {b.sign ? -division.first : division.first, remainder};
+    }
+    limbs::scratch_buffer d(b.size());
+    const uint32_t shift = big_integer::normalize(d.data(), b);
+    return big_integer::long_div(a, d.data(), b.size(), shift, nullptr, b.sign);
+}
+
+std::pair<big_integer, big_integer> divmod(const big_integer &a, const big_integer::divisor &b) {
+    if (b.normalized.empty()) {
+        return divmod(a, b.value);
+    } else if (a.size() < b.normalized.size()) {
+        return {big_integer(), a};
+    }
+    return big_integer::long_div(a, b.normalized.data(), b.normalized.size(), b.shift,
+                                 b.inverse.empty() ? nullptr : b.inverse.data(), b.value.sign);
+}
+
+std::string to_string(const big_integer &a, const int base, const bool show_base) {
+    if (base < 2 || base > 36) {
+        throw std::invalid_argument("Expected: base from 2 to 36, found: " + std::to_string(base));
+    }
+    std::string str(to_chars_size(a, base), '0');
+    str.resize(static_cast<size_t>(to_chars(&str[0], &str[0] + str.size(), a, base).ptr - &str[0]));
+    if (show_base && str != "0") {
+        str.insert(a.sign ? 1 : 0, base == 16 ? "0x" : base == 2 ? "0b" : base == 8 ? "0" : "");
     }
-    reverse(str.begin(), str.end());
     return str;
 }
 
 std::ostream &operator<<(std::ostream &s, const big_integer &a) {
-    s << to_string(a);
+    const std::ios_base::fmtflags flags = s.flags();
+    const std::ios_base::fmtflags basefield = flags & std::ios_base::basefield;
+    if (s.width() == 0 && basefield != std::ios_base::hex && basefield != std::ios_base::oct) {
+        //  десятичная запись без строки целиком: старшие цифры уходят в поток первыми
+        const std::ostream::sentry sentry(s);
+        if (sentry) {
+            std::streambuf &out = *s.rdbuf();
+            bool written = !a.sign || out.sputc('-') != std::char_traits<char>::eof();
+            if (a.size() == 1 && a[0] == 0) {
+                written = written && out.sputc('0') != std::char_traits<char>::eof();
+            } else {
+                written = written && big_integer::write_digits(out, a, 0, 10);
+            }
+            if (!written) {
+                s.setstate(std::ios_base::badbit);
+            }
+        }
+        return s;
+    }
+    //  с шириной поля нужна длина записи заранее, степени двойки и так линейны
+    std::string str = to_string(a, basefield == std::ios_base::hex ? 16 : basefield == std::ios_base::oct ? 8 : 10,
+                                (flags & std::ios_base::showbase) != 0);
+    if (flags & std::ios_base::uppercase) {
+        std::transform(str.begin(), str.end(), str.begin(), [](const char c) {
+            return 'a' <= c && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+        });
+    }
+    s << str;
+    return s;
+}
+
+std::istream &operator>>(std::istream &s, big_integer &a) {
+    const std::istream::sentry sentry(s);
+    if (!sentry) {
+        return s;
+    }
+    const std::ios_base::fmtflags basefield = s.flags() & std::ios_base::basefield;
+    big_integer::parser parser(basefield == std::ios_base::hex ? 16 : basefield == std::ios_base::oct ? 8 : 10);
+    std::streambuf &in = *s.rdbuf();
+    std::ios_base::iostate state = std::ios_base::goodbit;
+    for (;;) {
+        const std::char_traits<char>::int_type c = in.sgetc();
+        if (c == std::char_traits<char>::eof()) {
+            state |= std::ios_base::eofbit;
+            break;
+        }
+        const char digit = std::char_traits<char>::to_char_type(c);
+        if (parser.feed(&digit, 1) == 0) {
+            break;
+        }
+        in.sbumpc();
+    }
+    if (parser.empty()) {
+        state |= std::ios_base::failbit;
+    } else {
+        a = parser.finish();
+    }
+    s.setstate(state);
     return s;
 }
 
 void big_integer::shrink_to_fit() {
+    digits();  //  пустой data сначала становится одним нулевым разрядом
     while (size() > 1 && data.back() == 0) {
         data.pop_back();
     }
@@ -1,13 +1,22 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <iomanip>
 #include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 #include <utility>
 #include <gtest/gtest.h>
 
 #include "big_integer.h"
 #include "big_integer_gmp.h"
+#include "limb_arithmetic.h"
+#include "limb_division.h"
+#include "ntt_multiplication.h"
+#include "limb_scratch.h"
 
 TEST(correctness, two_plus_two) {
   EXPECT_EQ(big_integer(4), big_integer(2) + big_integer(2));
@@ -557,6 +566,445 @@ TEST(correctness, string_conv) {
   EXPECT_EQ("-2147483649", to_string(lim));
 }
 
+TEST(correctness, string_conv_long_zeros) {
+  big_integer power = 1;
+  std::string expected = "1";
+  for (size_t digits = 0; digits != 3000; ++digits) {
+    EXPECT_EQ(expected, to_string(power));
+    EXPECT_EQ("-" + expected, to_string(-power));
+    power *= 10;
+    expected += '0';
+  }
+  EXPECT_EQ(std::string(2999, '9'), to_string(power / 10 - 1));
+  EXPECT_EQ("1" + std::string(3000, '0') + "1", to_string(power * 10 + 1));
+}
+
+TEST(correctness, string_conv_long) {
+  std::default_random_engine rng(42);
+  for (const size_t length : {8, 9, 10, 1023, 1024, 1025, 20000}) {
+    std::string digits(1, static_cast<char>('1' + rng() % 9));
+    while (digits.size() < length) {
+      digits += static_cast<char>('0' + rng() % 10);
+    }
+    EXPECT_EQ(digits, to_string(big_integer(digits)));
+    EXPECT_EQ("-" + digits, to_string(big_integer("-" + digits)));
+    EXPECT_EQ(digits, to_string(big_integer(std::string(3000, '0') + digits)));
+  }
+  EXPECT_THROW(big_integer("12a4"), std::runtime_error);
+  EXPECT_THROW(big_integer(std::string(5000, '7') + "-"), std::runtime_error);
+  EXPECT_THROW(big_integer(""), std::runtime_error);
+}
+
+TEST(correctness, string_conv_non_digit) {
+  const char non_digits[] = {'/', ':', 'a', ' ', '-', '\x80', '\xff'};
+  for (size_t position = 0; position != 70; ++position) {
+    for (const char c : non_digits) {
+      std::string str(70, '5');
+      str[position] = c;
+      if (position == 0 && c == '-') {
+        continue;
+      }
+      try {
+        big_integer a(str);
+        ADD_FAILURE() << "no exception for a non-digit at " << position;
+      } catch (const std::runtime_error &e) {
+        EXPECT_EQ("Expected: digit, found: " + std::string(1, c), e.what());
+      }
+    }
+  }
+  EXPECT_EQ("99999999999999999999", to_string(big_integer("99999999999999999999")));
+  EXPECT_EQ("1234567890123456789", to_string(big_integer("1234567890123456789")));
+}
+
+TEST(correctness, to_chars_bases) {
+  std::default_random_engine rng(13);
+  const std::string digit_chars = "0123456789abcdefghijklmnopqrstuvwxyz";
+  for (size_t bits : {1u, 31u, 32u, 100u, 1500u, 5000u, 40000u}) {
+    big_integer_gmp gmp_a;
+    gmp_a.random(bits, rng);
+    const big_integer a(to_string(gmp_a));
+    for (const big_integer &x : {a, -a}) {
+      for (int base = 2; base <= 36; ++base) {
+        std::string str(to_chars_size(x, base), '?');
+        const to_chars_result written = to_chars(&str[0], &str[0] + str.size(), x, base);
+        ASSERT_EQ(std::errc(), written.ec);
+        EXPECT_LE(str.size(), static_cast<size_t>(written.ptr - &str[0]) + 2);
+        str.resize(static_cast<size_t>(written.ptr - &str[0]));
+        if (bits <= 1500) {
+          std::string expected;
+          for (big_integer rest = x < 0 ? -x : x; rest != 0; rest /= base) {
+            expected += digit_chars[std::stoi(to_string(rest % base))];
+          }
+          expected += x < 0 ? "-" : expected.empty() ? "0" : "";
+          std::reverse(expected.begin(), expected.end());
+          EXPECT_EQ(expected, str);
+        }
+        big_integer y;
+        const from_chars_result read = from_chars(str.data(), str.data() + str.size(), y, base);
+        EXPECT_EQ(std::errc(), read.ec);
+        EXPECT_EQ(str.data() + str.size(), read.ptr);
+        EXPECT_EQ(x, y);
+      }
+    }
+  }
+}
+
+TEST(correctness, to_chars_buffer_too_small) {
+  const big_integer a = (big_integer(1) << 100) - 1;
+  const std::string expected = "1267650600228229401496703205375";
+  char buffer[64];
+  for (size_t size = 0; size <= expected.size() + 1; ++size) {
+    std::fill(buffer, buffer + 64, '?');
+    const to_chars_result written = to_chars(buffer, buffer + size, -a);
+    if (size <= expected.size()) {
+      EXPECT_EQ(std::errc::value_too_large, written.ec);
+      EXPECT_EQ(buffer + size, written.ptr);
+    } else {
+      EXPECT_EQ(std::errc(), written.ec);
+      EXPECT_EQ("-" + expected, std::string(buffer, written.ptr));
+    }
+    EXPECT_EQ('?', buffer[size]);
+  }
+  EXPECT_EQ(std::errc::invalid_argument, to_chars(buffer, buffer + 64, a, 37).ec);
+  EXPECT_EQ("0", std::string(buffer, to_chars(buffer, buffer + 1, 0, 2).ptr));
+}
+
+TEST(correctness, to_chars_exact_buffer) {
+  for (int base : {3, 10, 36}) {
+    for (int bits : {1, 40, 5000}) {
+      const big_integer a = -((big_integer(1) << bits) / 3 + 1);
+      const std::string expected = to_string(a, base);
+      std::vector<char> buffer(expected.size() + 1, '?');
+      const to_chars_result written = to_chars(buffer.data(), buffer.data() + expected.size(), a, base);
+      EXPECT_EQ(std::errc(), written.ec);
+      EXPECT_EQ(expected, std::string(buffer.data(), written.ptr));
+      EXPECT_EQ('?', buffer.back());
+      std::fill(buffer.begin(), buffer.end(), '?');
+      const to_chars_result short_by_one = to_chars(buffer.data(), buffer.data() + expected.size() - 1, a, base);
+      EXPECT_EQ(std::errc::value_too_large, short_by_one.ec);
+      EXPECT_EQ('?', buffer[expected.size() - 1]);
+    }
+  }
+}
+
+TEST(correctness, from_chars_prefix) {
+  big_integer a = 7;
+  const std::string bad[] = {"", "-", "x1", "-x", "+1", " 1"};
+  for (const std::string &str : bad) {
+    const from_chars_result read = from_chars(str.data(), str.data() + str.size(), a);
+    EXPECT_EQ(std::errc::invalid_argument, read.ec);
+    EXPECT_EQ(str.data(), read.ptr);
+    EXPECT_EQ(7, a);
+  }
+  const std::string hex = "-DeadBeefCafeBabe1234g5";
+  const from_chars_result read = from_chars(hex.data(), hex.data() + hex.size(), a, 16);
+  EXPECT_EQ(std::errc(), read.ec);
+  EXPECT_EQ(hex.data() + hex.find('g'), read.ptr);
+  EXPECT_EQ(big_integer("-1051570404360395033547316"), a);
+  const std::string zero = "-000";
+  from_chars(zero.data(), zero.data() + zero.size(), a, 2);
+  EXPECT_EQ(0, a);
+  EXPECT_EQ("0", to_string(a));
+  EXPECT_EQ(std::errc::invalid_argument, from_chars(zero.data(), zero.data() + zero.size(), a, 1).ec);
+}
+
+TEST(correctness, pow2_radix_prefix) {
+  const big_integer a("-1051570404360395033547316");
+  EXPECT_EQ("-deadbeefcafebabe1234", to_string(a, 16));
+  EXPECT_EQ("-0xdeadbeefcafebabe1234", to_string(a, 16, true));
+  EXPECT_EQ("0b101", to_string(5, 2, true));
+  EXPECT_EQ("017", to_string(15, 8, true));
+  EXPECT_EQ("0", to_string(0, 16, true));
+  EXPECT_THROW(to_string(a, 64), std::invalid_argument);
+
+  std::ostringstream out;
+  out << std::hex << std::showbase << std::uppercase << a << ' ' << std::oct << big_integer(8);
+  EXPECT_EQ("-0XDEADBEEFCAFEBABE1234 010", out.str());
+
+  const std::pair<std::string, std::string> prefixed[] = {
+      {"-0xDeadBeefCafeBabe1234", "-1051570404360395033547316"},
+      {"0b1011", "11"}, {"0755", "493"}, {"0x", "0"}, {"0xg", "0"}, {"0", "0"}, {"123", "123"}};
+  for (const auto &test : prefixed) {
+    big_integer b;
+    const from_chars_result read = from_chars(test.first.data(), test.first.data() + test.first.size(), b, 0);
+    EXPECT_EQ(std::errc(), read.ec);
+    EXPECT_EQ(big_integer(test.second), b);
+  }
+}
+
+TEST(correctness, pow2_radix_long) {
+  std::default_random_engine rng(14);
+  big_integer_gmp gmp_a;
+  gmp_a.random(100000, rng);
+  const big_integer a(to_string(gmp_a));
+  for (int base : {2, 4, 8, 16, 32}) {
+    const std::string str = to_string(a, base);
+    EXPECT_EQ(to_chars_size(a, base), str.size());
+    big_integer b;
+    EXPECT_EQ(str.data() + str.size(), from_chars(str.data(), str.data() + str.size(), b, base).ptr);
+    EXPECT_EQ(a, b);
+  }
+}
+
+TEST(correctness, stream_output) {
+  std::default_random_engine rng(15);
+  big_integer_gmp gmp_a;
+  gmp_a.random(50000, rng);
+  const big_integer a(to_string(gmp_a));
+  for (const big_integer &x : {a, -a, a / (big_integer(1) << 40000), big_integer(), big_integer(-7)}) {
+    std::ostringstream out;
+    out << x << ' ' << std::setw(8) << std::setfill('*') << big_integer(-5) << std::setw(0) << x;
+    EXPECT_EQ(to_string(x) + " ******-5" + to_string(x), out.str());
+  }
+  const big_integer power("1" + std::string(5000, '0'));
+  std::ostringstream out;
+  out << power - 1 << power;
+  EXPECT_EQ(std::string(5000, '9') + "1" + std::string(5000, '0'), out.str());
+}
+
+TEST(correctness, stream_input) {
+  std::istringstream in("  -123456789012345678901234567890 42\n0 -0 +5");
+  big_integer a, b, c, d, e = 7;
+  in >> a >> b >> c >> d;
+  EXPECT_EQ(big_integer("-123456789012345678901234567890"), a);
+  EXPECT_EQ(42, b);
+  EXPECT_EQ(0, c);
+  EXPECT_EQ(0, d);
+  EXPECT_EQ("0", to_string(d));
+  EXPECT_FALSE(in >> e);
+  EXPECT_EQ(7, e);
+
+  std::istringstream hex("-DeadBeefCafeBabe1234");
+  hex >> std::hex >> a;
+  EXPECT_TRUE(hex.eof());
+  EXPECT_EQ(big_integer("-1051570404360395033547316"), a);
+
+  std::istringstream minus("- 1");
+  EXPECT_FALSE(minus >> e);
+  EXPECT_EQ(7, e);
+}
+
+TEST(correctness, push_parser) {
+  std::default_random_engine rng(16);
+  for (size_t bits : {1u, 100u, 3000u, 70000u}) {
+    big_integer_gmp gmp_a;
+    gmp_a.random(bits, rng);
+    const std::string str = to_string(gmp_a);
+    for (size_t piece : {1u, 7u, 1000u}) {
+      big_integer::parser parser;
+      EXPECT_TRUE(parser.empty());
+      for (size_t i = 0; i < str.size(); i += piece) {
+        const size_t n = std::min(piece, str.size() - i);
+        EXPECT_EQ(n, parser.feed(str.data() + i, n));
+      }
+      EXPECT_EQ(0u, parser.feed("-", 1));
+      EXPECT_EQ(big_integer(str), parser.finish());
+      EXPECT_TRUE(parser.empty());
+    }
+  }
+  big_integer::parser parser(2);
+  EXPECT_EQ(4u, parser.feed("-1012", 5));
+  EXPECT_EQ(-5, parser.finish());
+  EXPECT_THROW(parser.finish(), std::runtime_error);
+}
+
+TEST(correctness, rvalue_operators) {
+  static_assert(std::is_nothrow_move_constructible<big_integer>::value, "big_integer moves must not throw");
+  static_assert(std::is_nothrow_move_assignable<big_integer>::value, "big_integer moves must not throw");
+  const big_integer values[] = {big_integer("123456789012345678901234567890"), big_integer("-98765432109876543210"),
+                  big_integer(0), big_integer(-1), big_integer(1) << 100};
+  for (const big_integer &a : values) {
+    for (const big_integer &b : values) {
+      EXPECT_EQ(a + b, a + big_integer(b));
+      EXPECT_EQ(a - b, a - big_integer(b));
+      EXPECT_EQ(a * b, a * big_integer(b));
+      EXPECT_EQ(a & b, a & big_integer(b));
+      EXPECT_EQ(a | b, a | big_integer(b));
+      EXPECT_EQ(a ^ b, a ^ big_integer(b));
+      EXPECT_EQ(b - a, big_integer(b) - big_integer(a));
+    }
+  }
+  big_integer a = values[0];
+  big_integer b = std::move(a);
+  a = b * 2;
+  EXPECT_EQ(values[0], b);
+  EXPECT_EQ(values[0] + values[0], a);
+}
+
+TEST(correctness, bitwise_result_carries_out) {
+  // the two's complement result is all zeros, so its magnitude needs one more limb
+  EXPECT_EQ(-(big_integer(1) << 32), (1 - (big_integer(1) << 32)) & -2);
+  EXPECT_EQ(-(big_integer(1) << 256), -((big_integer(1) << 256) - 1) & big_integer("-8869916364"));
+  EXPECT_EQ(-(big_integer(1) << 64), -((big_integer(1) << 64) - 1) & -((big_integer(1) << 33) + 2));
+}
+
+TEST(correctness, negative_shift_past_top) {
+  for (int shift : {31, 32, 33, 64, 160, 300}) {
+    EXPECT_EQ(-1, big_integer(-5) >> shift);
+    EXPECT_EQ(0, big_integer(5) >> shift);
+  }
+  const big_integer b = -(big_integer(1) << 100) + 3;
+  for (int shift : {100, 101, 128, 160, 300}) {
+    EXPECT_EQ(-1, b >> shift);
+    EXPECT_EQ(0, -b >> shift);
+  }
+  big_integer a = -(big_integer(1) << 64);
+  a >>= 96;
+  EXPECT_EQ(-1, a);
+  EXPECT_EQ(0, a + 1);
+}
+
+TEST(correctness, shr_negative_floor) {
+  EXPECT_EQ(-9000, big_integer(-9000) >> 0);
+  EXPECT_EQ(-2, big_integer(-4) >> 1);
+  EXPECT_EQ(-1, big_integer(-8) >> 3);
+  EXPECT_EQ(-2, big_integer(-9) >> 3);
+  EXPECT_EQ(-(big_integer(1) << 36), -(big_integer(1) << 100) >> 64);
+  EXPECT_EQ(-(big_integer(1) << 36) - 1, (-1 - (big_integer(1) << 100)) >> 64);
+  EXPECT_EQ(-3, (-3 * (big_integer(1) << 70)) >> 70);
+  big_integer a = -(big_integer(1) << 96) - (big_integer(1) << 40);
+  a >>= 40;
+  EXPECT_EQ(-(big_integer(1) << 56) - 1, a);
+}
+
+TEST(correctness, moved_from_is_zero) {
+  for (const big_integer &value : {big_integer(-7), -(big_integer(1) << 300) + 1}) {
+    big_integer a = value;
+    big_integer b = std::move(a);
+    EXPECT_EQ(value, b);
+    EXPECT_EQ("0", to_string(a));
+    EXPECT_EQ(0, a);
+    a += 5;
+    EXPECT_EQ(5, a);
+    big_integer c = value;
+    c = std::move(b);
+    EXPECT_EQ(value, c);
+    EXPECT_EQ("0", to_string(b));
+    EXPECT_EQ(-value, b - c);
+  }
+}
+
+TEST(correctness, moved_from_in_expressions) {
+  const big_integer value = (big_integer(1) << 100) - 3;
+  auto moved_from = [&value]() {
+    big_integer a = value;
+    big_integer b = std::move(a);
+    return a;
+  };
+  EXPECT_EQ(0, moved_from() * value);
+  EXPECT_EQ(value, value + moved_from());
+  EXPECT_EQ(-value, moved_from() - value);
+  EXPECT_EQ(0, moved_from() / value);
+  EXPECT_EQ(-1, ~moved_from());
+  EXPECT_EQ(value, moved_from() | value);
+  EXPECT_EQ(0, moved_from() << 70);
+  EXPECT_EQ(0, moved_from() >> 70);
+  EXPECT_TRUE(moved_from() < value);
+  EXPECT_EQ(moved_from(), -moved_from());
+  big_integer a = moved_from();
+  EXPECT_EQ(0, a);
+  a *= value;
+  EXPECT_EQ(0, a);
+}
+
+TEST(correctness, shared_copy_mutation) {
+  const big_integer original = (big_integer(1) << 200) - 12345;
+  for (int shift : {0, 1, 31, 32, 33, 64, 250}) {
+    big_integer a = original, b = original, c = original, d = original;
+    a <<= shift;
+    b >>= shift;
+    c += c;
+    d -= original;
+    EXPECT_EQ((big_integer(1) << (200 + shift)) - 12345 * (big_integer(1) << shift), a);
+    EXPECT_EQ(original / (big_integer(1) << shift), b);
+    EXPECT_EQ(original * 2, c);
+    EXPECT_EQ(0, d);
+    EXPECT_EQ((big_integer(1) << 200) - 12345, original);
+  }
+  big_integer a = -original, b = a;
+  a &= original;
+  EXPECT_EQ(-original, b);
+  EXPECT_EQ(1, a);
+}
+
+TEST(correctness, scratch_buffers_lifo) {
+  limbs::scratch_buffer::trim();
+  EXPECT_EQ(0u, limbs::scratch_buffer::reserved_bytes());
+  {
+    limbs::scratch_buffer a(10, 7);
+    {
+      limbs::scratch_buffer b(100000, 1);  //  does not fit the first chunk
+      limbs::scratch_buffer c(5, 2);
+      EXPECT_EQ(1u, b[99999]);
+      EXPECT_EQ(2u, c[4]);
+    }
+    limbs::scratch_buffer d(20, 3);
+    EXPECT_EQ(7u, a[9]);
+    EXPECT_EQ(3u, d[19]);
+    EXPECT_LE(100000 * sizeof(uint32_t), limbs::scratch_buffer::reserved_bytes());
+  }
+  limbs::scratch_buffer::trim();
+  EXPECT_EQ(0u, limbs::scratch_buffer::reserved_bytes());
+}
+
+TEST(correctness, arithmetic_steady_state) {
+  const big_integer m = (big_integer(1) << 2000) - 159;
+  const big_integer y = (big_integer(1) << 1999) / 7 + 12345;
+  const big_integer d = (big_integer(1) << 1200) / 11 + 1;
+  const big_integer mask = (big_integer(1) << 1500) - 1;
+  big_integer x = (big_integer(1) << 1990) / 3;
+  big_integer z;
+  auto step = [&]() {
+    x *= y;
+    x %= m;
+    z = -x;
+    z /= d;
+    z &= mask;
+    z ^= y;
+  };
+  for (int i = 0; i < 3; ++i) {
+    step();
+  }
+  const size_t reserved = limbs::scratch_buffer::reserved_bytes();
+  for (int i = 0; i < 100; ++i) {
+    step();
+  }
+  EXPECT_EQ(reserved, limbs::scratch_buffer::reserved_bytes());
+  EXPECT_LT(x, m);
+  EXPECT_LE(big_integer(0), x);
+}
+
+TEST(correctness, radix_cache_trim) {
+  big_integer::trim_radix_cache();
+  EXPECT_EQ(0u, big_integer::radix_cache_bytes());
+  const big_integer a = (big_integer(1) << 20000) - 1;
+  const std::string expected = to_string(a);
+  EXPECT_LT(0u, big_integer::radix_cache_bytes());
+  big_integer::trim_radix_cache();
+  EXPECT_EQ(0u, big_integer::radix_cache_bytes());
+  EXPECT_EQ(expected, to_string(a));
+  EXPECT_EQ(a, big_integer(expected));
+}
+
+TEST(correctness, radix_cache_across_threads) {
+  const std::string expected = to_string((big_integer(1) << 20000) - 1);
+  std::vector<std::thread> threads;
+  std::vector<int> matches(4, 0);
+  for (size_t t = 0; t < matches.size(); ++t) {
+    threads.emplace_back([&expected, &matches, t]() {
+      const big_integer value = (big_integer(1) << 20000) - 1;
+      for (int i = 0; i < 5; ++i) {
+        matches[t] += to_string(value) == expected;
+        big_integer::trim_radix_cache();  //  the other threads keep the powers they hold
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(std::vector<int>(matches.size(), 5), matches);
+}
+
 namespace {
 size_t const number_of_iterations = 10;
 size_t const max_size = 2048;
@@ -670,6 +1118,67 @@ TEST(correctness, div_randomized) {
   }
 }
 
+TEST(correctness, div_digit_estimation) {
+  // all-ones and sparse limbs make the quotient digit estimate too large
+  std::vector<big_integer> values;
+  for (int high : {64, 96, 160, 320}) {
+    for (int low : {0, 1, 31, 32, 33, 63}) {
+      values.push_back((big_integer(1) << high) - (big_integer(1) << low));
+      values.push_back((big_integer(1) << high) + (big_integer(1) << low));
+      values.push_back(-(big_integer(1) << high) + 1);
+    }
+  }
+  for (const big_integer &a : values) {
+    for (const big_integer &b : values) {
+      big_integer_gmp gmp_a(to_string(a)), gmp_b(to_string(b));
+      EXPECT_EQ(to_string(gmp_a / gmp_b), to_string(a / b));
+      EXPECT_EQ(to_string(gmp_a % gmp_b), to_string(a % b));
+      big_integer square = a * a;
+      EXPECT_EQ(to_string(gmp_a * gmp_a / gmp_b), to_string(square / b));
+      EXPECT_EQ(to_string(gmp_a * gmp_a % gmp_b), to_string(square % b));
+    }
+  }
+}
+
+TEST(correctness, short_div_all_shifts) {
+  std::default_random_engine rng(42);
+  big_integer_gmp gmp_a;
+  gmp_a.random(max_size, rng);
+  big_integer a(to_string(gmp_a));
+  for (int shift = 0; shift < 32; ++shift) {
+    for (uint32_t delta : {0u, 1u, 12345u}) {
+      std::string divisor = std::to_string((1ull << shift) + delta);
+      big_integer_gmp gmp_b(divisor);
+      big_integer b(divisor);
+      EXPECT_EQ(to_string(gmp_a / gmp_b), to_string(a / b));
+      EXPECT_EQ(to_string(gmp_a % gmp_b), to_string(a % b));
+    }
+  }
+}
+
+TEST(correctness, div_negative_pow2) {
+  big_integer a = -(big_integer(1) << 65);
+  EXPECT_EQ(-2, a / (big_integer(1) << 64));
+  EXPECT_EQ(-1, (a + 1) / (big_integer(1) << 64));
+  EXPECT_EQ(0, a % (big_integer(1) << 64));
+}
+
+TEST(correctness, divmod) {
+  const int values[] = {7, -7, 100, -100};
+  for (const int a : values) {
+    for (const int b : {2, -2, 7, -7}) {
+      const std::pair<big_integer, big_integer> ans = divmod(a, b);
+      EXPECT_EQ(a / b, ans.first);
+      EXPECT_EQ(a % b, ans.second);
+    }
+  }
+  big_integer a("-1000000000000000000000000000000000000001"), b("1000000000000000000000");
+  const std::pair<big_integer, big_integer> ans = divmod(a, b);
+  EXPECT_EQ(big_integer("-1000000000000000000"), ans.first);
+  EXPECT_EQ(-1, ans.second);
+  EXPECT_EQ(a, ans.first * b + ans.second);
+}
+
 // y2019 tests
 
 TEST(correctness_random, cmp) {
@@ -724,6 +1233,136 @@ TEST(correctness_random, mul) {
   }
 }
 
+namespace {
+  ///  temporarily changes a tuning threshold, so that small numbers go through fast algorithms
+  struct threshold_guard {
+    threshold_guard(size_t &threshold, size_t value) : threshold(threshold), saved(threshold) {
+      threshold = value;
+    }
+
+    ~threshold_guard() {
+      threshold = saved;
+    }
+
+  private:
+    size_t &threshold;
+    size_t saved;
+  };
+
+  void check_sqr(size_t size, size_t iterations, std::default_random_engine &rng) {
+    for (size_t itn = 0; itn != iterations; ++itn) {
+      big_integer_gmp a;
+      a.random(size, rng);
+      big_integer_gmp c = a * a;
+      big_integer R = big_integer(to_string(a));
+      big_integer copy = R;
+      EXPECT_EQ(to_string(c), to_string(R * R));
+      EXPECT_EQ(to_string(c), to_string(R * big_integer(to_string(a))));
+      R *= R;
+      EXPECT_EQ(to_string(c), to_string(R));
+      copy *= -copy;
+      EXPECT_EQ(to_string(-c), to_string(copy));
+    }
+  }
+
+  void check_mul(size_t a_size, size_t b_size, size_t iterations, std::default_random_engine &rng) {
+    for (size_t itn = 0; itn != iterations; ++itn) {
+      big_integer_gmp a, b;
+      a.random(a_size, rng);
+      b.random(b_size, rng);
+      big_integer_gmp c = a * b;
+      big_integer R = big_integer(to_string(a)) * big_integer(to_string(b));
+      EXPECT_EQ(to_string(c), to_string(R));
+    }
+  }
+
+  void check_div(size_t a_size, size_t b_size, size_t iterations, std::default_random_engine &rng) {
+    for (size_t itn = 0; itn != iterations; ++itn) {
+      big_integer_gmp a, b;
+      a.random(a_size, rng);
+      b.random(b_size, rng);
+      EXPECT_EQ(to_string(a / b), to_string(big_integer(to_string(a)) / big_integer(to_string(b))));
+      EXPECT_EQ(to_string(a % b), to_string(big_integer(to_string(a)) % big_integer(to_string(b))));
+    }
+  }
+}
+
+TEST(correctness_random, mul_karatsuba) {
+  std::default_random_engine rng(42);
+  check_mul(20 * max_size, 20 * max_size, 2, rng);
+  check_mul(20 * max_size, 3 * max_size, 2, rng);
+  check_mul(3 * max_size, 7 * max_size, 2, rng);
+}
+
+TEST(correctness_random, mul_karatsuba_small_threshold) {
+  threshold_guard guard(limbs::karatsuba_threshold, 2);
+  std::default_random_engine rng(42);
+  check_mul(max_size, max_size, number_of_iterations, rng);
+  check_mul(max_size, max_size / 3, number_of_iterations, rng);
+  check_mul(100, 70, number_of_iterations, rng);
+}
+
+TEST(correctness_random, mul_toom) {
+  std::default_random_engine rng(42);
+  check_mul(30 * max_size, 30 * max_size, 1, rng);
+  check_mul(40 * max_size, 30 * max_size, 1, rng);
+  check_mul(55 * max_size, 30 * max_size, 1, rng);
+  check_mul(70 * max_size, 30 * max_size, 1, rng);
+}
+
+TEST(correctness_random, mul_ntt) {
+  limbs::ntt_trim();
+  std::default_random_engine rng(42);
+  check_mul(40 * max_size, 40 * max_size, 1, rng);
+  check_mul(64 * max_size, 33 * max_size, 1, rng);
+  check_sqr(40 * max_size, 1, rng);
+  EXPECT_LT(0u, limbs::ntt_reserved_bytes());  // the default thresholds reached the transforms
+}
+
+TEST(correctness_random, mul_toom_small_threshold) {
+  threshold_guard karatsuba(limbs::karatsuba_threshold, 4);
+  threshold_guard toom(limbs::toom_threshold, 16);
+  std::default_random_engine rng(42);
+  for (size_t percent = 100; percent <= 300; percent += 10) {
+    check_mul(max_size, max_size * 100 / percent, 2, rng);
+  }
+  check_mul(4 * max_size, 4 * max_size, number_of_iterations, rng);
+}
+
+TEST(correctness_random, mul_ntt_small_threshold) {
+  threshold_guard ntt(limbs::ntt_threshold, 16);
+  std::default_random_engine rng(42);
+  check_mul(max_size, max_size, number_of_iterations, rng);
+  check_mul(4 * max_size, max_size, number_of_iterations, rng);
+  check_mul(100, 1000, number_of_iterations, rng);
+}
+
+TEST(correctness_random, sqr_ntt_small_threshold) {
+  threshold_guard ntt(limbs::ntt_threshold, 16);
+  std::default_random_engine rng(42);
+  check_sqr(4 * max_size, number_of_iterations, rng);
+}
+
+TEST(correctness_random, ntt_trim) {
+  threshold_guard ntt(limbs::ntt_threshold, 16);
+  std::default_random_engine rng(42);
+  check_mul(max_size, max_size, 1, rng);
+  EXPECT_LT(0u, limbs::ntt_reserved_bytes());
+  limbs::ntt_trim();
+  EXPECT_EQ(0u, limbs::ntt_reserved_bytes());
+  check_mul(max_size, max_size, 1, rng);  //  the tables are rebuilt
+}
+
+TEST(correctness_random, sqr) {
+  std::default_random_engine rng(42);
+  check_sqr(max_size, number_of_iterations, rng);
+  check_sqr(30 * max_size, 1, rng);
+  threshold_guard karatsuba(limbs::karatsuba_threshold, 4);
+  check_sqr(max_size, number_of_iterations, rng);
+  threshold_guard toom(limbs::toom_threshold, 16);
+  check_sqr(4 * max_size, number_of_iterations, rng);
+}
+
 TEST(correctness_random, div) {
   std::default_random_engine rng(322);
   for (size_t itn = 0; itn != number_of_iterations; ++itn) {
@@ -740,6 +1379,48 @@ TEST(correctness_random, div) {
   }
 }
 
+TEST(correctness_random, div_burnikel_ziegler) {
+  std::default_random_engine rng(322);
+  check_div(30 * max_size, 10 * max_size, 1, rng);
+  check_div(30 * max_size, 18 * max_size, 1, rng);
+  check_div(30 * max_size, 4 * max_size, 1, rng);
+}
+
+TEST(correctness_random, div_burnikel_ziegler_small_threshold) {
+  threshold_guard bz(limbs::bz_threshold, 4);
+  threshold_guard karatsuba(limbs::karatsuba_threshold, 4);
+  std::default_random_engine rng(322);
+  check_div(max_size, max_size / 2, number_of_iterations, rng);
+  check_div(max_size, max_size / 3, number_of_iterations, rng);
+  check_div(max_size, max_size * 2 / 3, number_of_iterations, rng);
+  check_div(4 * max_size, max_size / 4, number_of_iterations, rng);
+  check_div(300, 200, number_of_iterations, rng);
+}
+
+TEST(correctness_random, div_newton_small_threshold) {
+  threshold_guard newton(limbs::newton_threshold, 8);
+  threshold_guard karatsuba(limbs::karatsuba_threshold, 4);
+  std::default_random_engine rng(322);
+  check_div(max_size, max_size / 2, number_of_iterations, rng);
+  check_div(max_size, max_size / 3, number_of_iterations, rng);
+  check_div(4 * max_size, max_size / 4, number_of_iterations, rng);
+  check_div(4 * max_size, 3 * max_size, number_of_iterations, rng);
+  check_div(300, 200, number_of_iterations, rng);
+}
+
+TEST(correctness_random, div_reused_divisor) {
+  threshold_guard newton(limbs::newton_threshold, 8);
+  std::default_random_engine rng(322);
+  big_integer_gmp b;
+  b.random(max_size / 2, rng);
+  const big_integer::divisor d(big_integer(to_string(b)));
+  for (size_t itn = 0; itn != number_of_iterations; ++itn) {
+    big_integer_gmp a;
+    a.random(max_size * (itn + 1) / 4, rng);
+    EXPECT_EQ(to_string(a / b), to_string(big_integer(to_string(a)) / d));
+  }
+}
+
 TEST(correctness_random, mod) {
   std::default_random_engine rng(322);
   for (size_t itn = 0; itn != number_of_iterations; ++itn) {
@@ -756,6 +1437,18 @@ TEST(correctness_random, mod) {
   }
 }
 
+TEST(correctness_random, divmod) {
+  std::default_random_engine rng(322);
+  for (size_t itn = 0; itn != number_of_iterations; ++itn) {
+    big_integer_gmp a, b;
+    a.random(max_size, rng);
+    b.random(max_size / 2, rng);
+    const std::pair<big_integer, big_integer> ans = divmod(big_integer(to_string(a)), big_integer(to_string(b)));
+    EXPECT_EQ(to_string(a / b), to_string(ans.first));
+    EXPECT_EQ(to_string(a % b), to_string(ans.second));
+  }
+}
+
 TEST(correctness_random, bitwise) {
   std::default_random_engine rng(42);
   for (size_t itn = 0; itn != number_of_iterations; ++itn) {
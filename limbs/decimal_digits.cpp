@@ -0,0 +1,101 @@
+#include "decimal_digits.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BIGINT_DIGITS_X86
+#endif
+
+namespace decimal {
+    namespace {
+        size_t find_non_digit_scalar(const char *s, const size_t n, size_t i) {
+            while (i < n && static_cast<unsigned char>(s[i] - '0') <= 9) {
+                ++i;
+            }
+            return i;
+        }
+
+#ifdef BIGINT_DIGITS_X86
+#ifdef __SSE2__  ///  part of x86-64, optional for 32-bit targets
+        size_t find_non_digit_sse2(const char *s, const size_t n) {
+            const __m128i zero = _mm_set1_epi8('0'), nine = _mm_set1_epi8(9);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {  ///  a byte is a digit iff max(byte - '0', 9) == 9 as unsigned
+                const __m128i value = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)), zero);
+                const auto mask = static_cast<unsigned>(
+                        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(value, nine), nine)));
+                if (mask != 0xFFFFu) {
+                    return i + __builtin_ctz(~mask);
+                }
+            }
+            return find_non_digit_scalar(s, n, i);
+        }
+#endif
+
+        __attribute__((target("avx2")))
+        size_t find_non_digit_avx2(const char *s, const size_t n) {
+            const __m256i zero = _mm256_set1_epi8('0'), nine = _mm256_set1_epi8(9);
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                const __m256i value = _mm256_sub_epi8(
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i)), zero);
+                const auto mask = static_cast<unsigned>(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(value, nine), nine)));
+                if (mask != 0xFFFFFFFFu) {
+                    return i + __builtin_ctz(~mask);
+                }
+            }
+            return find_non_digit_scalar(s, n, i);
+        }
+
+        using find_function = size_t (*)(const char *, size_t);
+
+        find_function select_find_non_digit() {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return find_non_digit_avx2;
+            }
+#ifdef __SSE2__
+            return find_non_digit_sse2;
+#else
+            return [](const char *s, const size_t n) { return find_non_digit_scalar(s, n, 0); };
+#endif
+        }
+#endif
+
+        ///  s[0, 8) as digits, the first one is the most significant
+        uint32_t parse_8(const char *s) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            uint64_t value;
+            std::memcpy(&value, s, sizeof(value));
+            value = (value & 0x0F0F0F0F0F0F0F0Fu) * 2561 >> 8u;  ///  pairs of digits in 16-bit lanes
+            value = (value & 0x00FF00FF00FF00FFu) * 6553601 >> 16u;  ///  four digits in 32-bit lanes
+            return static_cast<uint32_t>((value & 0x0000FFFF0000FFFFu) * 42949672960001u >> 32u);
+#else
+            uint32_t value = 0;
+            for (size_t i = 0; i < 8; ++i) {
+                value = value * 10 + static_cast<uint32_t>(s[i] - '0');
+            }
+            return value;
+#endif
+        }
+    }
+
+    size_t find_non_digit(const char *s, const size_t n) {
+#ifdef BIGINT_DIGITS_X86
+        static const find_function find = select_find_non_digit();
+        return find(s, n);
+#else
+        return find_non_digit_scalar(s, n, 0);
+#endif
+    }
+
+    uint32_t parse(const char *s, const size_t n) {
+        if (n == 9) {
+            return static_cast<uint32_t>(s[0] - '0') * 100000000u + parse_8(s + 1);
+        }
+        char padded[8] = {'0', '0', '0', '0', '0', '0', '0', '0'};
+        std::memcpy(padded + 8 - n, s, n);
+        return parse_8(padded);
+    }
+}
@@ -0,0 +1,17 @@
+#include <cstddef>
+#include <cstdint>
+
+#ifndef BIGINT_DECIMAL_DIGITS_H
+#define BIGINT_DECIMAL_DIGITS_H
+
+///  Kernels on ASCII decimal digits for the string constructor. Validation scans 32 or 16 bytes
+///  per step with AVX2 or SSE2, chosen at runtime; conversion reads 8 digits as one 64-bit word
+///  and combines them with three multiplications (SWAR). Other targets use scalar loops.
+namespace decimal {
+    ///  @methods
+    size_t find_non_digit(const char *s, size_t n);  ///  index of the first non-digit in s[0, n), n if none
+
+    uint32_t parse(const char *s, size_t n);  ///  value of n <= 9 decimal digits, pre: all of them are digits
+}
+
+#endif //BIGINT_DECIMAL_DIGITS_H
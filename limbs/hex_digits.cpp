@@ -0,0 +1,55 @@
+#include "hex_digits.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BIGINT_HEX_X86
+#endif
+
+namespace hex {
+    namespace {
+        const char DIGITS[] = "0123456789abcdef";
+
+        void write_scalar(char *out, const uint32_t *a, size_t n) {
+            while (n != 0) {
+                const uint32_t limb = a[--n];
+                for (int shift = 28; shift >= 0; shift -= 4) {
+                    *out++ = DIGITS[limb >> static_cast<uint32_t>(shift) & 0xFu];
+                }
+            }
+        }
+
+#ifdef BIGINT_HEX_X86
+        __attribute__((target("ssse3")))
+        void write_ssse3(char *out, const uint32_t *a, size_t n) {
+            const __m128i reverse = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+            const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i *>(DIGITS));
+            const __m128i low_nibbles = _mm_set1_epi8(0x0F);
+            for (; n >= 4; n -= 4, out += 32) {  ///  a[n - 4, n) as 16 big-endian bytes
+                const __m128i bytes = _mm_shuffle_epi8(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + n - 4)), reverse);
+                const __m128i high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(bytes, 4), low_nibbles));
+                const __m128i low = _mm_shuffle_epi8(table, _mm_and_si128(bytes, low_nibbles));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi8(high, low));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16), _mm_unpackhi_epi8(high, low));
+            }
+            write_scalar(out, a, n);
+        }
+
+        using write_function = void (*)(char *, const uint32_t *, size_t);
+
+        write_function select_write() {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("ssse3") ? write_ssse3 : write_scalar;
+        }
+#endif
+    }
+
+    void write(char *out, const uint32_t *a, const size_t n) {
+#ifdef BIGINT_HEX_X86
+        static const write_function write_digits = select_write();
+        write_digits(out, a, n);
+#else
+        write_scalar(out, a, n);
+#endif
+    }
+}
@@ -0,0 +1,15 @@
+#include <cstddef>
+#include <cstdint>
+
+#ifndef BIGINT_HEX_DIGITS_H
+#define BIGINT_HEX_DIGITS_H
+
+///  Kernels on ASCII hexadecimal digits for power-of-two radix output. With SSSE3, chosen at runtime,
+///  four limbs are byte-reversed, split into nibbles and mapped to characters by one table shuffle
+///  each; other targets use a scalar loop over the nibbles.
+namespace hex {
+    ///  @methods
+    void write(char *out, const uint32_t *a, size_t n);  ///  8 * n lowercase digits, the most significant first
+}
+
+#endif //BIGINT_HEX_DIGITS_H
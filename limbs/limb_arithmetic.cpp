@@ -0,0 +1,463 @@
+#include "limb_arithmetic.h"
+#include "ntt_multiplication.h"
+#include "limb_scratch.h"
+#include <algorithm>
+#include <utility>
+
+namespace limbs {
+    size_t karatsuba_threshold = 32;
+    ///  measured against Karatsuba at the top level: Toom-3 is slower up to about 1024 limbs and breaks
+    ///  even from about 1500; from 2048 limbs the smaller operand goes to NTT anyway
+    size_t toom_threshold = 1792;
+    size_t ntt_threshold = 2048;
+
+    uint32_t add_1(uint32_t *r, const uint32_t *a, const size_t n, uint32_t b) {
+        for (size_t i = 0; i < n; ++i) {
+            const auto sum = static_cast<uint64_t>(a[i]) + b;
+            r[i] = static_cast<uint32_t>(sum);
+            b = static_cast<uint32_t>(sum >> 32u);
+        }
+        return b;
+    }
+
+    uint32_t sub_1(uint32_t *r, const uint32_t *a, const size_t n, uint32_t b) {
+        for (size_t i = 0; i < n; ++i) {
+            const uint32_t diff = a[i] - b;
+            b = a[i] < b;
+            r[i] = diff;
+        }
+        return b;
+    }
+
+    uint32_t add_n(uint32_t *r, const uint32_t *a, const uint32_t *b, const size_t n) {
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            carry += static_cast<uint64_t>(a[i]) + b[i];
+            r[i] = static_cast<uint32_t>(carry);
+            carry >>= 32u;
+        }
+        return static_cast<uint32_t>(carry);
+    }
+
+    uint32_t sub_n(uint32_t *r, const uint32_t *a, const uint32_t *b, const size_t n) {
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const uint64_t diff = static_cast<uint64_t>(a[i]) - b[i] - borrow;
+            r[i] = static_cast<uint32_t>(diff);
+            borrow = diff >> 63u;
+        }
+        return static_cast<uint32_t>(borrow);
+    }
+
+    uint32_t add(uint32_t *r, const uint32_t *a, const size_t an, const uint32_t *b, const size_t bn) {
+        const uint32_t carry = add_n(r, a, b, bn);
+        return add_1(r + bn, a + bn, an - bn, carry);
+    }
+
+    uint32_t sub(uint32_t *r, const uint32_t *a, const size_t an, const uint32_t *b, const size_t bn) {
+        const uint32_t borrow = sub_n(r, a, b, bn);
+        return sub_1(r + bn, a + bn, an - bn, borrow);
+    }
+
+    int cmp(const uint32_t *a, const uint32_t *b, size_t n) {
+        while (n-- > 0) {
+            if (a[n] != b[n]) {
+                return a[n] < b[n] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    uint32_t mul_1(uint32_t *r, const uint32_t *a, const size_t n, const uint32_t b) {
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            carry += static_cast<uint64_t>(a[i]) * b;
+            r[i] = static_cast<uint32_t>(carry);
+            carry >>= 32u;
+        }
+        return static_cast<uint32_t>(carry);
+    }
+
+    uint32_t addmul_1(uint32_t *r, const uint32_t *a, const size_t n, const uint32_t b) {
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            carry += static_cast<uint64_t>(a[i]) * b + r[i];
+            r[i] = static_cast<uint32_t>(carry);
+            carry >>= 32u;
+        }
+        return static_cast<uint32_t>(carry);
+    }
+
+    uint32_t submul_1(uint32_t *r, const uint32_t *a, const size_t n, const uint32_t b) {
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < n; ++i) {
+            borrow += static_cast<uint64_t>(a[i]) * b;
+            const auto low = static_cast<uint32_t>(borrow);
+            borrow = (borrow >> 32u) + (r[i] < low);
+            r[i] -= low;
+        }
+        return static_cast<uint32_t>(borrow);
+    }
+
+    uint32_t lshift(uint32_t *r, const uint32_t *a, size_t n, const uint32_t shift) {
+        const uint32_t out = a[n - 1] >> (32 - shift);
+        while (--n > 0) {
+            r[n] = (a[n] << shift) | (a[n - 1] >> (32 - shift));
+        }
+        r[0] = a[0] << shift;
+        return out;
+    }
+
+    uint32_t rshift(uint32_t *r, const uint32_t *a, const size_t n, const uint32_t shift) {
+        const uint32_t out = a[0] << (32 - shift);
+        for (size_t i = 0; i + 1 < n; ++i) {
+            r[i] = (a[i] >> shift) | (a[i + 1] << (32 - shift));
+        }
+        r[n - 1] = a[n - 1] >> shift;
+        return out;
+    }
+
+    uint32_t neg(uint32_t *r, const uint32_t *a, const size_t n) {
+        uint32_t borrow = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const uint32_t x = a[i];
+            r[i] = 0u - x - borrow;
+            borrow |= x != 0;
+        }
+        return borrow;
+    }
+
+    void divexact_by3(uint32_t *r, const uint32_t *a, const size_t n) {
+        const uint32_t inverse = 0xAAAAAAABu;  ///  3 * inverse = 1 modulo B
+        uint32_t borrow = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const uint32_t x = a[i], y = x - borrow;
+            borrow = x < borrow;
+            const uint32_t q = y * inverse;
+            r[i] = q;
+            borrow += static_cast<uint32_t>((static_cast<uint64_t>(q) * 3) >> 32u);
+        }
+    }
+
+    void rshift1_signed(uint32_t *r, const uint32_t *a, const size_t n) {
+        uint32_t high = a[n - 1] & 0x80000000u;
+        for (size_t i = n; i-- > 0;) {
+            const uint32_t x = a[i];
+            r[i] = (x >> 1u) | high;
+            high = x << 31u;
+        }
+    }
+
+    void mul_basecase(uint32_t *r, const uint32_t *a, const size_t an, const uint32_t *b, const size_t bn) {
+        r[an] = mul_1(r, a, an, b[0]);
+        for (size_t i = 1; i < bn; ++i) {
+            r[an + i] = addmul_1(r + i, a, an, b[i]);
+        }
+    }
+
+    void sqr_basecase(uint32_t *r, const uint32_t *a, const size_t n) {
+        std::fill(r, r + 2 * n, 0);
+        for (size_t i = 0; i + 1 < n; ++i) {  ///  a[i] * a[j] for i < j
+            r[i + n] = addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+        }
+        lshift(r, r, 2 * n, 1);
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const uint64_t square = static_cast<uint64_t>(a[i]) * a[i];
+            carry += static_cast<uint64_t>(r[2 * i]) + static_cast<uint32_t>(square);
+            r[2 * i] = static_cast<uint32_t>(carry);
+            carry >>= 32u;
+            carry += static_cast<uint64_t>(r[2 * i + 1]) + (square >> 32u);
+            r[2 * i + 1] = static_cast<uint32_t>(carry);
+            carry >>= 32u;
+        }
+    }
+
+    namespace {
+        ///  Karatsuba needs at least two limbs to split
+        bool use_karatsuba(const size_t n) {
+            return n >= std::max<size_t>(karatsuba_threshold, 2);
+        }
+
+        ///  the piece sizes chosen by mul keep every Toom piece non-empty starting from 16 limbs
+        bool use_toom(const size_t n) {
+            return n >= std::max<size_t>(toom_threshold, 16);
+        }
+
+        bool use_ntt(const size_t n) {
+            return n >= ntt_threshold;
+        }
+
+        ///  scratch limbs used by mul_n on n-limb operands
+        size_t mul_n_scratch_size(size_t n) {
+            size_t total = 0;
+            while (use_karatsuba(n) && !use_toom(n)) {
+                const size_t h = n - n / 2;
+                total += 4 * h + 2;
+                n = h;
+            }
+            return total;
+        }
+
+        ///  r = |a - b| where a has an >= bn limbs, r has an limbs; returns true if a < b
+        bool abs_diff(uint32_t *r, const uint32_t *a, const size_t an, const uint32_t *b, const size_t bn) {
+            bool a_smaller = true;
+            for (size_t i = bn; i < an; ++i) {
+                if (a[i] != 0) {
+                    a_smaller = false;
+                    break;
+                }
+            }
+            if (a_smaller) {
+                a_smaller = cmp(a, b, bn) < 0;
+            }
+            if (a_smaller) {
+                sub_n(r, b, a, bn);
+                std::fill(r + bn, r + an, 0);
+            } else {
+                sub(r, a, an, b, bn);
+            }
+            return a_smaller;
+        }
+
+        ///  r[0, rn) += a[0, an) << shift, where shift < 32 - 2 and an <= rn
+        void addlsh(uint32_t *r, const size_t rn, const uint32_t *a, const size_t an, const uint32_t shift) {
+            uint64_t carry = 0;
+            for (size_t i = 0; i < an; ++i) {
+                carry += (static_cast<uint64_t>(a[i]) << shift) + r[i];
+                r[i] = static_cast<uint32_t>(carry);
+                carry >>= 32u;
+            }
+            add_1(r + an, r + an, rn - an, static_cast<uint32_t>(carry));
+        }
+
+        ///  a is split into count pieces of k limbs, the last one has `last` limbs;
+        ///  plus = a(1), minus = |a(-1)|, minus2 = |a(-2)|, all of them have k + 1 limbs.
+        ///  Returns the signs of a(-1) and a(-2).
+        std::pair<bool, bool> evaluate(uint32_t *plus, uint32_t *minus, uint32_t *minus2, uint32_t *tmp,
+                                       const uint32_t *a, const size_t k, const size_t count, const size_t last) {
+            uint32_t *even = tmp, *odd = tmp + k + 1;
+            std::pair<bool, bool> negative;
+            for (uint32_t shift = 0; shift < 2; ++shift) {
+                std::fill(even, even + 2 * (k + 1), 0);
+                for (size_t i = 0; i < count; ++i) {
+                    addlsh(i % 2 == 0 ? even : odd, k + 1, a + i * k, i + 1 == count ? last : k,
+                           shift * static_cast<uint32_t>(i));
+                }
+                if (shift == 0) {
+                    add_n(plus, even, odd, k + 1);
+                    negative.first = abs_diff(minus, even, k + 1, odd, k + 1);
+                } else {
+                    negative.second = abs_diff(minus2, even, k + 1, odd, k + 1);
+                }
+            }
+            return negative;
+        }
+
+        ///  r (rn limbs) = sum of coefficients c[i] * B^(i * k), every coefficient is a two's complement
+        ///  number of l limbs whose real value is non-negative and fits the result
+        void assemble(uint32_t *r, const size_t rn, const size_t k, uint32_t *const *c, const size_t count,
+                      const size_t l) {
+            std::fill(r, r + rn, 0);
+            for (size_t i = 0; i < count; ++i) {
+                add(r + i * k, r + i * k, rn - i * k, c[i], std::min(l, rn - i * k));
+            }
+        }
+
+        ///  Bodrato's interpolation sequence for the points 0, 1, -1, -2 and infinity.
+        ///  All values are two's complement numbers of l limbs, the coefficients are left in place:
+        ///  v1 <- c1, vm1 <- c2, vm2 <- c3
+        void interpolate5(const uint32_t *v0, uint32_t *v1, uint32_t *vm1, uint32_t *vm2, const uint32_t *vinf,
+                          const size_t l) {
+            sub_n(vm2, vm2, v1, l);
+            divexact_by3(vm2, vm2, l);  ///  r3 = (v(-2) - v(1)) / 3
+            sub_n(v1, v1, vm1, l);
+            rshift1_signed(v1, v1, l);  ///  r1 = (v(1) - v(-1)) / 2
+            sub_n(vm1, vm1, v0, l);  ///  r2 = v(-1) - v(0)
+            sub_n(vm2, vm1, vm2, l);
+            rshift1_signed(vm2, vm2, l);
+            add_n(vm2, vm2, vinf, l);
+            add_n(vm2, vm2, vinf, l);  ///  r3 = (r2 - r3) / 2 + 2 * v(inf)
+            add_n(vm1, vm1, v1, l);
+            sub_n(vm1, vm1, vinf, l);  ///  r2 = r2 + r1 - v(inf)
+            sub_n(v1, v1, vm2, l);  ///  r1 = r1 - r3
+        }
+
+        ///  r = x * y in l limbs of two's complement, x and y have k + 1 limbs
+        void signed_product(uint32_t *r, const uint32_t *x, const uint32_t *y, const size_t k, const bool negative) {
+            mul(r, x, k + 1, y, k + 1);
+            if (negative) {
+                neg(r, r, 2 * k + 2);
+            }
+        }
+
+        ///  r = a * b, the pieces of a: k, k, ..., s limbs (a_count pieces); of b: k, ..., t limbs (b_count pieces),
+        ///  a_count + b_count - 1 is 5 (Toom-33, Toom-42) or 4 (Toom-32)
+        void toom(uint32_t *r, const uint32_t *a, const size_t an, const uint32_t *b, const size_t bn, const size_t k,
+                  const size_t a_count, const size_t b_count) {
+            const size_t s = an - (a_count - 1) * k, t = bn - (b_count - 1) * k, l = 2 * k + 2;
+            const size_t points = a_count + b_count - 1;
+            scratch_buffer workspace(8 * (k + 1) + 5 * l, 0);
+            uint32_t *ap = workspace.data(), *am = ap + k + 1, *am2 = am + k + 1;
+            uint32_t *bp = am2 + k + 1, *bm = bp + k + 1, *bm2 = bm + k + 1, *tmp = bm2 + k + 1;
+            uint32_t *v0 = tmp + 2 * (k + 1), *v1 = v0 + l, *vm1 = v1 + l, *vm2 = vm1 + l, *vinf = vm2 + l;
+
+            const auto a_negative = evaluate(ap, am, am2, tmp, a, k, a_count, s);
+            auto b_negative = a_negative;
+            if (a == b && an == bn) {  ///  the products below become squares
+                bp = ap;
+                bm = am;
+                bm2 = am2;
+            } else {
+                b_negative = evaluate(bp, bm, bm2, tmp, b, k, b_count, t);
+            }
+            mul(v0, a, k, b, k);
+            mul(vinf, a + (a_count - 1) * k, s, b + (b_count - 1) * k, t);
+            mul(v1, ap, k + 1, bp, k + 1);
+            signed_product(vm1, am, bm, k, a_negative.first != b_negative.first);
+
+            if (points == 5) {
+                signed_product(vm2, am2, bm2, k, a_negative.second != b_negative.second);
+                interpolate5(v0, v1, vm1, vm2, vinf, l);
+                uint32_t *coefficients[] = {v0, v1, vm1, vm2, vinf};
+                assemble(r, an + bn, k, coefficients, 5, l);
+            } else {  ///  v(1) + v(-1) = 2 * (c0 + c2), v(1) - v(-1) = 2 * (c1 + c3)
+                sub_n(v1, v1, vm1, l);
+                add_n(vm1, vm1, vm1, l);
+                add_n(vm1, vm1, v1, l);
+                rshift1_signed(v1, v1, l);
+                rshift1_signed(vm1, vm1, l);
+                sub_n(v1, v1, vinf, l);
+                sub_n(vm1, vm1, v0, l);
+                uint32_t *coefficients[] = {v0, v1, vm1, vinf};
+                assemble(r, an + bn, k, coefficients, 4, l);
+            }
+        }
+
+        void mul_n(uint32_t *r, const uint32_t *a, const uint32_t *b, size_t n, uint32_t *scratch);
+
+        ///  a is cut into pieces of p >= bn limbs, which are multiplied by b one by one
+        void mul_pieces(uint32_t *r, const uint32_t *a, const size_t an, const uint32_t *b, const size_t bn,
+                        const size_t p) {
+            scratch_buffer scratch(p + bn + mul_n_scratch_size(bn));
+            uint32_t *tmp = scratch.data(), *next = tmp + p + bn;
+            for (size_t i = 0; i < an; i += p) {
+                const size_t len = std::min(p, an - i);
+                uint32_t *product = i == 0 ? r : tmp;
+                if (len == bn) {
+                    mul_n(product, a + i, b, bn, next);
+                } else {
+                    mul(product, a + i, len, b, bn);
+                }
+                if (i != 0) {  ///  the previous piece has already filled r[i, i + bn)
+                    const uint32_t carry = add_n(r + i, r + i, tmp, bn);
+                    std::copy(tmp + bn, tmp + bn + len, r + i + bn);
+                    add_1(r + i + bn, r + i + bn, len, carry);
+                }
+            }
+        }
+
+        ///  a = a1 * B^m + a0, b = b1 * B^m + b0,
+        ///  a * b = z2 * B^2m + (z0 + z2 - (a1 - a0)(b1 - b0)) * B^m + z0
+        void karatsuba(uint32_t *r, const uint32_t *a, const uint32_t *b, const size_t n, uint32_t *scratch) {
+            const size_t m = n / 2, h = n - m;
+            uint32_t *da = scratch, *db = scratch + h, *z1 = scratch + 2 * h + 1, *next = scratch + 4 * h + 2;
+            mul_n(r, a, b, m, next);
+            mul_n(r + 2 * m, a + m, b + m, h, next);
+            const bool negative = abs_diff(da, a + m, h, a, m) != abs_diff(db, b + m, h, b, m);
+            mul_n(z1, da, db, h, next);
+            uint32_t *t = scratch;  ///  da and db are not needed any more
+            t[2 * h] = add(t, r + 2 * m, 2 * h, r, 2 * m);
+            if (negative) {
+                add(t, t, 2 * h + 1, z1, 2 * h);
+            } else {
+                sub(t, t, 2 * h + 1, z1, 2 * h);
+            }
+            add(r + m, r + m, m + 2 * h, t, 2 * h + 1);
+        }
+
+        void sqr_n(uint32_t *r, const uint32_t *a, size_t n, uint32_t *scratch);
+
+        ///  the same as karatsuba, but z1 = (a1 - a0)^2 is never negative
+        void karatsuba_sqr(uint32_t *r, const uint32_t *a, const size_t n, uint32_t *scratch) {
+            const size_t m = n / 2, h = n - m;
+            uint32_t *da = scratch, *z1 = scratch + 2 * h + 1, *next = scratch + 4 * h + 2;
+            sqr_n(r, a, m, next);
+            sqr_n(r + 2 * m, a + m, h, next);
+            abs_diff(da, a + m, h, a, m);
+            sqr_n(z1, da, h, next);
+            uint32_t *t = scratch;
+            t[2 * h] = add(t, r + 2 * m, 2 * h, r, 2 * m);
+            sub(t, t, 2 * h + 1, z1, 2 * h);
+            add(r + m, r + m, m + 2 * h, t, 2 * h + 1);
+        }
+
+        void sqr_n(uint32_t *r, const uint32_t *a, const size_t n, uint32_t *scratch) {
+            if (use_ntt(n) && 2 * n <= NTT_MAX_SIZE) {
+                ntt_mul(r, a, n, a, n);
+            } else if (use_toom(n)) {
+                toom(r, a, n, a, n, 1 + (n - 1) / 3, 3, 3);
+            } else if (use_karatsuba(n)) {
+                karatsuba_sqr(r, a, n, scratch);
+            } else {
+                sqr_basecase(r, a, n);
+            }
+        }
+
+        void mul_n(uint32_t *r, const uint32_t *a, const uint32_t *b, const size_t n, uint32_t *scratch) {
+            if (use_ntt(n) && 2 * n <= NTT_MAX_SIZE) {
+                ntt_mul(r, a, n, b, n);
+            } else if (use_toom(n)) {
+                toom(r, a, n, b, n, 1 + (n - 1) / 3, 3, 3);
+            } else if (use_karatsuba(n)) {
+                karatsuba(r, a, b, n, scratch);
+            } else {
+                mul_basecase(r, a, n, b, n);
+            }
+        }
+    }
+
+    void mul(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn) {
+        if (a == b && an == bn) {
+            sqr(r, a, an);
+            return;
+        }
+        if (an < bn) {
+            std::swap(a, b);
+            std::swap(an, bn);
+        }
+        if (!use_karatsuba(bn)) {
+            mul_basecase(r, a, an, b, bn);
+            return;
+        }
+        if (use_ntt(bn)) {
+            if (an + bn <= NTT_MAX_SIZE) {
+                ntt_mul(r, a, an, b, bn);
+                return;
+            } else if (2 * bn <= NTT_MAX_SIZE) {
+                mul_pieces(r, a, an, b, bn, NTT_MAX_SIZE - bn);
+                return;
+            }
+        }
+        if (use_toom(bn) && 2 * an < 5 * bn) {  ///  pieces of size k, see use_toom for the bounds
+            if (4 * an < 5 * bn) {
+                toom(r, a, an, b, bn, 1 + (an - 1) / 3, 3, 3);
+            } else if (4 * an < 7 * bn) {
+                toom(r, a, an, b, bn, 1 + (2 * an >= 3 * bn ? (an - 1) / 3 : (bn - 1) / 2), 3, 2);
+            } else {
+                toom(r, a, an, b, bn, 1 + (an >= 2 * bn ? (an - 1) / 4 : (bn - 1) / 2), 4, 2);
+            }
+            return;
+        }
+        mul_pieces(r, a, an, b, bn, bn);
+    }
+
+    void sqr(uint32_t *r, const uint32_t *a, const size_t n) {
+        if (!use_karatsuba(n)) {
+            sqr_basecase(r, a, n);
+            return;
+        }
+        scratch_buffer scratch(mul_n_scratch_size(n));
+        sqr_n(r, a, n, scratch.data());
+    }
+}
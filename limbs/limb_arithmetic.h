@@ -0,0 +1,58 @@
+#include <cstddef>
+#include <cstdint>
+
+#ifndef BIGINT_LIMB_ARITHMETIC_H
+#define BIGINT_LIMB_ARITHMETIC_H
+
+///  Kernels on raw little-endian ranges of 32-bit limbs. They know nothing about signs and storages,
+///  so big_integer hands them pointers to its digits. Unless stated otherwise, the result range
+///  must not overlap the operands.
+namespace limbs {
+    ///  @tuning
+    extern size_t karatsuba_threshold;  ///  smallest operand size (in limbs) multiplied by Karatsuba
+
+    extern size_t toom_threshold;  ///  smallest operand size (in limbs) multiplied by Toom-33, Toom-32 or Toom-42
+
+    extern size_t ntt_threshold;  ///  smallest operand size (in limbs) multiplied by number-theoretic transforms
+
+    ///  @methods
+    uint32_t add_1(uint32_t *r, const uint32_t *a, size_t n, uint32_t b);  ///  r = a + b, returns carry, r may be a
+
+    uint32_t sub_1(uint32_t *r, const uint32_t *a, size_t n, uint32_t b);  ///  r = a - b, returns borrow, r may be a
+
+    uint32_t add_n(uint32_t *r, const uint32_t *a, const uint32_t *b, size_t n);  ///  r may be a or b
+
+    uint32_t sub_n(uint32_t *r, const uint32_t *a, const uint32_t *b, size_t n);  ///  r may be a or b
+
+    uint32_t add(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn);  ///  pre: an >= bn
+
+    uint32_t sub(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn);  ///  pre: an >= bn
+
+    int cmp(const uint32_t *a, const uint32_t *b, size_t n);  ///  sign of a - b
+
+    uint32_t mul_1(uint32_t *r, const uint32_t *a, size_t n, uint32_t b);  ///  r = a * b, returns the high limb
+
+    uint32_t addmul_1(uint32_t *r, const uint32_t *a, size_t n, uint32_t b);  ///  r += a * b, returns the high limb
+
+    uint32_t submul_1(uint32_t *r, const uint32_t *a, size_t n, uint32_t b);  ///  r -= a * b, returns the borrow limb
+
+    uint32_t lshift(uint32_t *r, const uint32_t *a, size_t n, uint32_t shift);  ///  0 < shift < 32, returns shifted out bits
+
+    uint32_t rshift(uint32_t *r, const uint32_t *a, size_t n, uint32_t shift);  ///  0 < shift < 32, returns a << (32 - shift)
+
+    uint32_t neg(uint32_t *r, const uint32_t *a, size_t n);  ///  two's complement negation modulo B^n, r may be a, returns a != 0
+
+    void divexact_by3(uint32_t *r, const uint32_t *a, size_t n);  ///  pre: 3 | a modulo B^n, r may be a
+
+    void rshift1_signed(uint32_t *r, const uint32_t *a, size_t n);  ///  arithmetic shift of a two's complement number
+
+    void mul_basecase(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn);  ///  O(an * bn)
+
+    void sqr_basecase(uint32_t *r, const uint32_t *a, size_t n);  ///  n * (n - 1) / 2 products and the diagonal
+
+    void mul(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn);  ///  r has an + bn limbs
+
+    void sqr(uint32_t *r, const uint32_t *a, size_t n);  ///  r = a * a, r has 2 * n limbs
+}
+
+#endif //BIGINT_LIMB_ARITHMETIC_H
@@ -0,0 +1,303 @@
+#include "limb_division.h"
+#include "limb_arithmetic.h"
+#include "limb_scratch.h"
+#include <algorithm>
+
+namespace limbs {
+    size_t bz_threshold = 40;
+    size_t newton_threshold = 100000;
+
+    namespace {
+        uint64_t join(const uint32_t high, const uint32_t low) {
+            return (static_cast<uint64_t>(high) << 32u) | low;
+        }
+
+        ///  (u1 u0) = q * d + r, pre: u1 < d, d is normalized, v = invert_limb(d)
+        uint32_t div_2by1(uint32_t &r, const uint32_t u1, const uint32_t u0, const uint32_t d, const uint32_t v) {
+            const uint64_t q = static_cast<uint64_t>(v) * u1 + join(u1, u0);
+            auto q1 = static_cast<uint32_t>(q >> 32u) + 1;
+            const auto q0 = static_cast<uint32_t>(q);
+            r = u0 - q1 * d;
+            if (r > q0) {
+                --q1;
+                r += d;
+            }
+            if (r >= d) {
+                ++q1;
+                r -= d;
+            }
+            return q1;
+        }
+
+        ///  (u2 u1 u0) = q * (d1 d0) + r, pre: (u2 u1) < (d1 d0), v = reciprocal_3by2(d1, d0)
+        uint32_t div_3by2(uint64_t &r, const uint32_t u2, const uint32_t u1, const uint32_t u0, const uint32_t d1,
+                          const uint32_t d0, const uint32_t v) {
+            const uint64_t q = static_cast<uint64_t>(v) * u2 + join(u2, u1);
+            auto q1 = static_cast<uint32_t>(q >> 32u);
+            const auto q0 = static_cast<uint32_t>(q);
+            const uint64_t d = join(d1, d0);
+            const uint32_t r1 = u1 - q1 * d1;
+            r = join(r1, u0) - static_cast<uint64_t>(d0) * q1 - d;
+            ++q1;
+            if (static_cast<uint32_t>(r >> 32u) >= q0) {
+                --q1;
+                r += d;
+            }
+            if (r >= d) {
+                ++q1;
+                r -= d;
+            }
+            return q1;
+        }
+
+        ///  schoolbook division, O(dn * (nn - dn))
+        uint32_t sb_div_qr(uint32_t *q, uint32_t *np, const size_t nn, const uint32_t *d, const size_t dn,
+                           const uint32_t v) {
+            const uint32_t qh = cmp(np + nn - dn, d, dn) >= 0;
+            if (qh) {
+                sub_n(np + nn - dn, np + nn - dn, d, dn);
+            }
+            const uint32_t d1 = d[dn - 1], d0 = d[dn - 2];
+            for (size_t i = nn - dn; i-- > 0;) {  ///  np[i, i + dn] < d * B, the next digit is below B
+                uint32_t *window = np + i;
+                uint32_t digit;
+                if (window[dn] == d1 && window[dn - 1] == d0) {  ///  3 by 2 division would overflow, the digit is B - 1
+                    digit = UINT32_MAX;
+                    window[dn] -= submul_1(window, d, dn, digit);
+                } else {  ///  the top three limbs are divided exactly, only the lower dn - 2 limbs may borrow
+                    uint64_t r;
+                    digit = div_3by2(r, window[dn], window[dn - 1], window[dn - 2], d1, d0, v);
+                    const uint32_t borrow = submul_1(window, d, dn - 2, digit);
+                    window[dn - 2] = static_cast<uint32_t>(r);
+                    window[dn - 1] = static_cast<uint32_t>(r >> 32u);
+                    window[dn] = 0u - sub_1(window + dn - 2, window + dn - 2, 2, borrow);
+                }
+                while (window[dn] != 0) {  ///  the window is negative, add back; happens with probability about 2 / B
+                    --digit;
+                    window[dn] += add_n(window, window, d, dn);
+                }
+                q[i] = digit;
+            }
+            return qh;
+        }
+
+        bool use_bz(const size_t n) {
+            return n >= std::max<size_t>(bz_threshold, 4);
+        }
+
+        bool use_newton(const size_t n) {
+            return n >= std::max<size_t>(newton_threshold, 2);
+        }
+
+        ///  np (2n limbs) / d (n limbs), the top n limbs of np may exceed d; remainder in np[0, n).
+        ///  The quotient is found in two halves, each one by dividing 2 * half limbs by the top half of d
+        ///  and correcting with a multiplication by the rest of d. tp has n limbs.
+        uint32_t dc_div_qr_n(uint32_t *q, uint32_t *np, const uint32_t *d, const size_t n, const uint32_t v,
+                             uint32_t *tp) {
+            if (!use_bz(n)) {
+                return sb_div_qr(q, np, 2 * n, d, n, v);
+            }
+            const size_t lo = n / 2, hi = n - lo;
+            uint32_t qh = dc_div_qr_n(q + lo, np + 2 * lo, d + lo, hi, v, tp);
+            mul(tp, q + lo, hi, d, lo);
+            uint32_t borrow = sub_n(np + lo, np + lo, tp, n);
+            if (qh != 0) {
+                borrow += sub_n(np + n, np + n, d, lo);
+            }
+            while (borrow != 0) {  ///  the estimated half is at most 2 too large
+                qh -= sub_1(q + lo, q + lo, hi, 1);
+                borrow -= add_n(np + lo, np + lo, d, n);
+            }
+
+            const uint32_t ql = dc_div_qr_n(q, np + hi, d + hi, lo, v, tp);
+            mul(tp, d, hi, q, lo);
+            borrow = sub_n(np, np, tp, n);
+            if (ql != 0) {
+                borrow += sub_n(np + lo, np + lo, d, hi);
+            }
+            while (borrow != 0) {
+                sub_1(q, q, lo, 1);
+                borrow -= add_n(np, np, d, n);
+            }
+            return qh;
+        }
+
+        ///  any nn >= dn, tp has dn limbs
+        uint32_t dc_div_qr(uint32_t *q, uint32_t *np, const size_t nn, const uint32_t *d, const size_t dn,
+                           const uint32_t v, uint32_t *tp) {
+            const size_t qn = nn - dn;
+            if (!use_bz(qn)) {
+                return sb_div_qr(q, np, nn, d, dn, v);
+            }
+            if (qn < dn) {  ///  divide by the top qn limbs of d, then subtract q times the rest of d
+                uint32_t qh = div_qr(q, np + dn - qn, 2 * qn, d + dn - qn, qn, v);
+                mul(tp, q, qn, d, dn - qn);
+                uint32_t borrow = sub_n(np, np, tp, dn);
+                if (qh != 0) {
+                    borrow += sub_n(np + qn, np + qn, d, dn - qn);
+                }
+                while (borrow != 0) {
+                    qh -= sub_1(q, q, qn, 1);
+                    borrow -= add_n(np, np, d, dn);
+                }
+                return qh;
+            }
+            size_t block = qn % dn;  ///  the highest quotient block is the shortest one, the rest have dn limbs
+            uint32_t qh;
+            if (block != 0) {
+                qh = dc_div_qr(q + qn - block, np + qn - block, dn + block, d, dn, v, tp);
+            } else {
+                block = dn;
+                qh = dc_div_qr_n(q + qn - dn, np + qn - dn, d, dn, v, tp);
+            }
+            for (size_t offset = qn - block; offset != 0;) {
+                offset -= dn;
+                dc_div_qr_n(q + offset, np + offset, d, dn, v, tp);
+            }
+            return qh;
+        }
+
+        ///  w (2 * dn limbs, the top dn below d) / d: the estimate floor(w_top * x / B^dn) is below
+        ///  the quotient by at most 4 + 5 (for an approximate x), the remainder stays in w[0, dn).
+        ///  tp has 2 * dn + 1 limbs.
+        void preinv_block(uint32_t *q, uint32_t *w, const uint32_t *d, const size_t dn, const uint32_t *x,
+                          uint32_t *tp) {
+            mul(tp, x, dn + 1, w + dn, dn);
+            std::copy(tp + dn, tp + 2 * dn, q);
+            mul(tp, q, dn, d, dn);
+            sub_n(w, w, tp, 2 * dn);  ///  the remainder is below 10 * d, so it ends at w[dn]
+            while (w[dn] != 0 || cmp(w, d, dn) >= 0) {
+                add_1(q, q, dn, 1);
+                w[dn] -= sub_n(w, w, d, dn);
+            }
+        }
+
+        ///  floor((B^2n - 1) / d) - 5 <= x <= floor((B^2n - 1) / d), x has n + 1 limbs
+        void invert_approx(uint32_t *x, const uint32_t *d, const size_t n) {
+            if (n == 1) {
+                x[0] = invert_limb(d[0]);
+                x[1] = 1;
+                return;
+            }
+            if (n <= 3 || !use_newton(n)) {  ///  B^2n - 1 is all ones
+                scratch_buffer np(2 * n, UINT32_MAX), tp(n);
+                x[n] = dc_div_qr(x, np.data(), 2 * n, d, n, reciprocal_3by2(d[n - 1], d[n - 2]), tp.data());
+                return;
+            }
+            ///  y approximates the reciprocal of the top h limbs of d. One Newton step
+            ///  x = y * B^l + y * e / B^2h, e = B^(n + h) - d * y, never exceeds the reciprocal of d and misses it
+            ///  by less than 1 + 4 for truncations, as h >= l + 2. Since |e| < 9 * B^n, the product takes
+            ///  only e[h, n] and y without its lowest limb, which keeps it within n limbs.
+            const size_t h = (n + 3) / 2, l = n - h;
+            uint32_t *y = x + l;
+            invert_approx(y, d + l, h);
+            std::fill(x, y, 0);
+            scratch_buffer e(n + h + 1), correction(n + 1);
+            mul(e.data(), d, n, y, h + 1);
+            const bool negative = e[n + h] != 0;
+            if (!negative) {
+                neg(e.data(), e.data(), n + h);
+            }
+            mul(correction.data(), y + 1, h, e.data() + h, l + 1);
+            if (negative) {  ///  rounded up, so that x stays below the reciprocal
+                sub(x, x, n + 1, correction.data() + h - 1, l + 2);
+                sub_1(x, x, n + 1, 4);
+            } else {
+                add(x, x, n + 1, correction.data() + h - 1, l + 2);
+            }
+        }
+    }
+
+    uint32_t invert_limb(const uint32_t d) {
+        return static_cast<uint32_t>(join(~d, UINT32_MAX) / d);
+    }
+
+    uint32_t reciprocal_3by2(const uint32_t d1, const uint32_t d0) {
+        uint32_t v = invert_limb(d1);
+        uint32_t p = d1 * v + d0;
+        if (p < d0) {
+            --v;
+            if (p >= d1) {
+                --v;
+                p -= d1;
+            }
+            p -= d1;
+        }
+        const uint64_t t = static_cast<uint64_t>(v) * d0;
+        const auto t1 = static_cast<uint32_t>(t >> 32u), t0 = static_cast<uint32_t>(t);
+        p += t1;
+        if (p < t1) {
+            --v;
+            if (join(p, t0) >= join(d1, d0)) {
+                --v;
+            }
+        }
+        return v;
+    }
+
+    uint32_t divrem_1(uint32_t *q, const uint32_t *a, const size_t n, uint32_t d) {
+        const auto shift = static_cast<uint32_t>(__builtin_clz(d));
+        d <<= shift;
+        const uint32_t v = invert_limb(d);
+        uint32_t r = shift == 0 ? 0 : a[n - 1] >> (32 - shift);
+        for (size_t i = n; i-- > 0;) {  ///  the dividend is shifted on the fly
+            const uint32_t u0 = shift == 0 ? a[i] : (a[i] << shift) | (i == 0 ? 0 : a[i - 1] >> (32 - shift));
+            q[i] = div_2by1(r, r, u0, d, v);
+        }
+        return r >> shift;
+    }
+
+    uint32_t div_qr(uint32_t *q, uint32_t *np, const size_t nn, const uint32_t *d, const size_t dn) {
+        return div_qr(q, np, nn, d, dn, reciprocal_3by2(d[dn - 1], d[dn - 2]));
+    }
+
+    uint32_t div_qr(uint32_t *q, uint32_t *np, const size_t nn, const uint32_t *d, const size_t dn, const uint32_t v) {
+        if (use_newton(dn) && 2 * (nn - dn) >= dn) {
+            scratch_buffer x(dn + 1);
+            invert_approx(x.data(), d, dn);
+            return div_qr_preinv(q, np, nn, d, dn, x.data());
+        }
+        if (!use_bz(dn) || !use_bz(nn - dn)) {
+            return sb_div_qr(q, np, nn, d, dn, v);
+        }
+        scratch_buffer tp(dn);
+        return dc_div_qr(q, np, nn, d, dn, v, tp.data());
+    }
+
+    void invert(uint32_t *x, const uint32_t *d, const size_t n) {
+        invert_approx(x, d, n);
+        scratch_buffer r(2 * n + 1);
+        mul(r.data(), x, n + 1, d, n);
+        while (add(r.data(), r.data(), 2 * n, d, n) == 0) {  ///  d * (x + 1) <= B^2n - 1
+            add_1(x, x, n + 1, 1);
+        }
+    }
+
+    uint32_t div_qr_preinv(uint32_t *q, uint32_t *np, const size_t nn, const uint32_t *d, const size_t dn,
+                           const uint32_t *x) {
+        const size_t qn = nn - dn;
+        const uint32_t qh = cmp(np + qn, d, dn) >= 0;
+        if (qh) {
+            sub_n(np + qn, np + qn, d, dn);
+        }
+        if (qn == 0) {
+            return qh;
+        }
+        scratch_buffer tp(2 * dn + 1);
+        size_t offset = qn - (qn % dn == 0 ? dn : qn % dn);
+        if (qn % dn != 0) {  ///  the highest block is shorter, it is padded with zeros to 2 * dn limbs
+            scratch_buffer w(2 * dn, 0), block(dn);
+            std::copy(np + offset, np + nn, w.data());
+            preinv_block(block.data(), w.data(), d, dn, x, tp.data());
+            std::copy(block.data(), block.data() + (qn - offset), q + offset);
+            std::copy(w.data(), w.data() + dn, np + offset);
+        } else {
+            preinv_block(q + offset, np + offset, d, dn, x, tp.data());
+        }
+        while (offset != 0) {
+            offset -= dn;
+            preinv_block(q + offset, np + offset, d, dn, x, tp.data());
+        }
+        return qh;
+    }
+}
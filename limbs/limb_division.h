@@ -0,0 +1,44 @@
+#include <cstddef>
+#include <cstdint>
+
+#ifndef BIGINT_LIMB_DIVISION_H
+#define BIGINT_LIMB_DIVISION_H
+
+///  Division kernels on raw limb ranges, see limb_arithmetic.h for the conventions.
+///  The divisor must be normalized: its highest limb has the top bit set. Quotient digits are
+///  estimated with precomputed reciprocals (Moller, Granlund, "Improved division by invariant
+///  integers"), so the loops do no hardware division. Long divisions are split recursively into
+///  2n / n halves (Burnikel, Ziegler, "Fast recursive division"), whose cost follows multiplication.
+///  For the longest divisors the quotient is estimated with a Newton reciprocal instead.
+namespace limbs {
+    ///  @tuning
+    extern size_t bz_threshold;  ///  smallest divisor and quotient size (in limbs) divided by Burnikel-Ziegler
+
+    extern size_t newton_threshold;  ///  smallest divisor size (in limbs) divided with a Newton reciprocal
+
+    ///  @methods
+    uint32_t invert_limb(uint32_t d);  ///  floor((B^2 - 1) / d) - B for a normalized d
+
+    uint32_t reciprocal_3by2(uint32_t d1, uint32_t d0);  ///  floor((B^3 - 1) / (d1 d0)) - B for a normalized d1
+
+    ///  q = a / d (n limbs, q may be a) for any d != 0, returns the remainder
+    uint32_t divrem_1(uint32_t *q, const uint32_t *a, size_t n, uint32_t d);
+
+    ///  Divides np (nn limbs) by d (dn >= 2 limbs) in place: q gets nn - dn limbs of the quotient,
+    ///  np[0, dn) gets the remainder. Returns the highest quotient limb (0 or 1).
+    ///  Schoolbook division for short divisors or quotients, recursive Burnikel-Ziegler otherwise.
+    uint32_t div_qr(uint32_t *q, uint32_t *np, size_t nn, const uint32_t *d, size_t dn);
+
+    ///  the same with v = reciprocal_3by2(d[dn - 1], d[dn - 2]) computed by the caller
+    uint32_t div_qr(uint32_t *q, uint32_t *np, size_t nn, const uint32_t *d, size_t dn, uint32_t v);
+
+    ///  x = floor((B^2n - 1) / d), x has n + 1 limbs (the highest is 1), by Newton iteration;
+    ///  costs a few multiplications of n limbs
+    void invert(uint32_t *x, const uint32_t *d, size_t n);
+
+    ///  div_qr with x = invert(d) kept by the caller: every dn limbs of the quotient cost two
+    ///  multiplications, so it pays off when the quotient has at least dn / 2 limbs
+    uint32_t div_qr_preinv(uint32_t *q, uint32_t *np, size_t nn, const uint32_t *d, size_t dn, const uint32_t *x);
+}
+
+#endif //BIGINT_LIMB_DIVISION_H
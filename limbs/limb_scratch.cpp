@@ -0,0 +1,110 @@
+#include "limb_scratch.h"
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+namespace limbs {
+    namespace {
+        const size_t MIN_CHUNK_SIZE = 4096;  ///  limbs, so short operations share the first chunk
+
+        struct chunk {
+            std::unique_ptr<uint32_t[]> limbs;
+            size_t capacity;
+            size_t used;
+
+            explicit chunk(const size_t capacity) : limbs(new uint32_t[capacity]), capacity(capacity), used(0) {}
+        };
+
+        ///  Borrowed limbs are never moved, so the stack grows by chunks instead of reallocating.
+        ///  Chunks above top are empty and wait for the next deep call.
+        struct scratch_stack {
+            std::vector<chunk> chunks;
+            size_t top = 0;  ///  the chunk new requests are taken from
+
+            uint32_t *take(const size_t n) {
+                if (chunks.empty()) {
+                    chunks.emplace_back(std::max(n, MIN_CHUNK_SIZE));
+                }
+                while (chunks[top].capacity - chunks[top].used < n) {
+                    const size_t capacity = std::max(n, 2 * chunks.back().capacity);
+                    if (top + 1 == chunks.size()) {
+                        chunks.emplace_back(capacity);
+                    } else if (chunks[top + 1].capacity < n) {  ///  an empty chunk that is too short is replaced
+                        chunks[top + 1] = chunk(capacity);
+                    }
+                    ++top;
+                }
+                uint32_t *limbs = chunks[top].limbs.get() + chunks[top].used;
+                chunks[top].used += n;
+                return limbs;
+            }
+
+            void give_back(const uint32_t *limbs, const size_t n) {
+                chunks[top].used -= n;
+                assert(limbs == chunks[top].limbs.get() + chunks[top].used && "scratch buffers must die in LIFO order");
+                static_cast<void>(limbs);
+                while (top > 0 && chunks[top].used == 0) {
+                    --top;
+                }
+            }
+        };
+
+        scratch_stack &thread_stack() {
+            static thread_local scratch_stack stack;
+            return stack;
+        }
+    }
+
+    scratch_buffer::scratch_buffer(const size_t size)
+            : limbs_(size == 0 ? nullptr : thread_stack().take(size)), size_(size) {}
+
+    scratch_buffer::scratch_buffer(const size_t size, const uint32_t val) : scratch_buffer(size) {
+        std::fill(limbs_, limbs_ + size_, val);
+    }
+
+    scratch_buffer::~scratch_buffer() {
+        if (size_ != 0) {
+            thread_stack().give_back(limbs_, size_);
+        }
+    }
+
+    uint32_t *scratch_buffer::data() {
+        return limbs_;
+    }
+
+    const uint32_t *scratch_buffer::data() const {
+        return limbs_;
+    }
+
+    size_t scratch_buffer::size() const {
+        return size_;
+    }
+
+    uint32_t &scratch_buffer::operator[](const size_t i) {
+        return limbs_[i];
+    }
+
+    const uint32_t &scratch_buffer::operator[](const size_t i) const {
+        return limbs_[i];
+    }
+
+    size_t scratch_buffer::reserved_bytes() {
+        size_t bytes = 0;
+        for (const chunk &c : thread_stack().chunks) {
+            bytes += c.capacity * sizeof(uint32_t);
+        }
+        return bytes;
+    }
+
+    void scratch_buffer::trim() {
+        scratch_stack &stack = thread_stack();
+        size_t keep = stack.top + 1;
+        if (keep == 1 && !stack.chunks.empty() && stack.chunks[0].used == 0) {
+            keep = 0;
+        }
+        if (keep < stack.chunks.size()) {
+            stack.chunks.erase(stack.chunks.begin() + static_cast<std::ptrdiff_t>(keep), stack.chunks.end());
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#include <cstddef>
+#include <cstdint>
+
+#ifndef BIGINT_LIMB_SCRATCH_H
+#define BIGINT_LIMB_SCRATCH_H
+
+///  Temporary limbs for the kernels and big_integer, borrowed from a thread-local stack. A buffer
+///  takes its space on construction and gives it back on destruction, so buffers of one thread must
+///  die in the reverse order of their creation, as automatic variables do. The stack keeps its
+///  chunks, so once it has grown to the peak need of a loop, further iterations allocate nothing.
+namespace limbs {
+    class scratch_buffer {
+        ///  @variables
+        uint32_t *limbs_;
+        size_t size_;
+
+        ///  @methods
+    public:
+        explicit scratch_buffer(size_t size);  ///  limbs are uninitialized
+
+        scratch_buffer(size_t size, uint32_t val);
+
+        scratch_buffer(const scratch_buffer &) = delete;
+
+        scratch_buffer &operator=(const scratch_buffer &) = delete;
+
+        ~scratch_buffer();
+
+        uint32_t *data();
+
+        const uint32_t *data() const;
+
+        size_t size() const;
+
+        uint32_t &operator[](size_t i);
+
+        const uint32_t &operator[](size_t i) const;
+
+        static size_t reserved_bytes();  ///  held by the calling thread's stack, borrowed or not
+
+        static void trim();  ///  frees the chunks of the calling thread that hold no borrowed limbs
+    };
+}
+
+#endif //BIGINT_LIMB_SCRATCH_H
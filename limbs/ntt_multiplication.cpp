@@ -0,0 +1,206 @@
+#include "ntt_multiplication.h"
+#include <algorithm>
+#include <vector>
+
+namespace limbs {
+    namespace {
+        using uint128_t = unsigned __int128;
+
+        ///  p = c * 2^k + 1, 3 is a primitive root of each of them. A convolution coefficient of two
+        ///  NTT_MAX_SIZE / 2 limb numbers is below 2^86 < P0 * P1 * P2.
+        const uint32_t P0 = 998244353, P1 = 167772161, P2 = 469762049;
+        const uint32_t GENERATOR = 3;
+
+        ///  -p^-1 modulo 2^32 for odd p by Newton's iteration from x = p, correct in the low 3 bits;
+        ///  each step doubles them, so 4 steps are enough
+        constexpr uint32_t negated_inverse(const uint32_t p, const uint32_t x, const int steps) {
+            return steps == 0 ? 0u - x : negated_inverse(p, x * (2 - p * x), steps - 1);
+        }
+
+        uint32_t pow_mod(uint64_t a, uint64_t e, const uint32_t p) {
+            uint64_t result = 1;
+            a %= p;
+            for (; e != 0; e >>= 1u) {
+                if (e & 1u) {
+                    result = result * a % p;
+                }
+                a = a * a % p;
+            }
+            return static_cast<uint32_t>(result);
+        }
+
+        ///  per-thread tables and buffers for one prime. Products are reduced by Montgomery's method with
+        ///  R = 2^32: the root tables are kept multiplied by R, so a product with a root comes out plain.
+        template<uint32_t P>
+        struct transform {
+            static_assert(P < (1u << 30u), "Montgomery products below need 4P < 2^32");
+
+            static constexpr uint32_t NEGATED_INVERSE = negated_inverse(P, P, 4);
+
+            ///  roots[len / 2 + j] = w_len^j * R for every len = 2, 4, ..., size, the same for inverse_roots
+            std::vector<uint32_t> roots, inverse_roots;
+            std::vector<uint32_t> residues;  ///  the convolution modulo P
+
+            size_t reserved_bytes() const {
+                return (roots.capacity() + inverse_roots.capacity() + residues.capacity()) * sizeof(uint32_t);
+            }
+
+            void release() {
+                std::vector<uint32_t>().swap(roots);
+                std::vector<uint32_t>().swap(inverse_roots);
+                std::vector<uint32_t>().swap(residues);
+            }
+
+            ///  a * b / R modulo P, not fully reduced: for a * b < 4P^2 the sum stays below 2^64
+            ///  and the result below 2P, since 4P < R
+            static uint32_t mul(const uint32_t a, const uint32_t b) {
+                const uint64_t product = static_cast<uint64_t>(a) * b;
+                const uint32_t m = static_cast<uint32_t>(product) * NEGATED_INVERSE;
+                return static_cast<uint32_t>((product + static_cast<uint64_t>(m) * P) >> 32u);
+            }
+
+            static uint32_t reduce(const uint32_t a) {  ///  a < 2P to a < P
+                return a >= P ? a - P : a;
+            }
+
+            static uint32_t to_montgomery(const uint32_t a) {  ///  a * R modulo P
+                return static_cast<uint32_t>((static_cast<uint64_t>(a) << 32u) % P);
+            }
+
+            void prepare_roots(const size_t n) {
+                if (roots.size() >= n) {
+                    return;
+                }
+                roots.assign(n, 0);
+                inverse_roots.assign(n, 0);
+                for (size_t half = 1; half < n; half *= 2) {
+                    const uint32_t w = pow_mod(GENERATOR, (P - 1) / (2 * half), P);
+                    const uint32_t step = to_montgomery(w), inverse_step = to_montgomery(pow_mod(w, P - 2, P));
+                    roots[half] = inverse_roots[half] = to_montgomery(1);
+                    for (size_t j = 1; j < half; ++j) {
+                        roots[half + j] = reduce(mul(roots[half + j - 1], step));
+                        inverse_roots[half + j] = reduce(mul(inverse_roots[half + j - 1], inverse_step));
+                    }
+                }
+            }
+
+            ///  decimation in frequency, natural order in, bit-reversed order out;
+            ///  values stay below 2P between the butterflies
+            void forward(uint32_t *a, const size_t n) const {
+                for (size_t len = n; len >= 2; len /= 2) {
+                    const size_t half = len / 2;
+                    const uint32_t *w = roots.data() + half;
+                    for (size_t i = 0; i < n; i += len) {
+                        for (size_t j = 0; j < half; ++j) {
+                            const uint32_t u = a[i + j], v = a[i + j + half];
+                            a[i + j] = u + v >= 2 * P ? u + v - 2 * P : u + v;
+                            a[i + j + half] = mul(u + 2 * P - v, w[j]);
+                        }
+                    }
+                }
+            }
+
+            ///  decimation in time, bit-reversed order in, natural order out, scaled by R / n: that undoes
+            ///  the 1 / R the pointwise Montgomery products of convolve leave
+            void inverse(uint32_t *a, const size_t n) const {
+                for (size_t len = 2; len <= n; len *= 2) {
+                    const size_t half = len / 2;
+                    const uint32_t *w = inverse_roots.data() + half;
+                    for (size_t i = 0; i < n; i += len) {
+                        for (size_t j = 0; j < half; ++j) {
+                            const uint32_t u = a[i + j], v = mul(a[i + j + half], w[j]);
+                            a[i + j] = u + v >= 2 * P ? u + v - 2 * P : u + v;
+                            a[i + j + half] = u >= v ? u - v : u + 2 * P - v;
+                        }
+                    }
+                }
+                const uint32_t scale = to_montgomery(to_montgomery(pow_mod(n, P - 2, P)));
+                for (size_t i = 0; i < n; ++i) {
+                    a[i] = reduce(mul(a[i], scale));
+                }
+            }
+
+            static void load(uint32_t *dst, const uint32_t *a, const size_t an, const size_t n) {
+                for (size_t i = 0; i < an; ++i) {
+                    dst[i] = a[i] % P;
+                }
+                std::fill(dst + an, dst + n, 0);
+            }
+
+            ///  residues = a * b modulo P and modulo x^n - 1, tmp holds n values
+            void convolve(const uint32_t *a, const size_t an, const uint32_t *b, const size_t bn, const size_t n,
+                          std::vector<uint32_t> &tmp) {
+                prepare_roots(n);
+                residues.resize(n);
+                load(residues.data(), a, an, n);
+                forward(residues.data(), n);
+                if (a == b && an == bn) {  ///  the pointwise products are divided by R, inverse makes up for it
+                    for (size_t i = 0; i < n; ++i) {
+                        residues[i] = mul(residues[i], residues[i]);
+                    }
+                } else {
+                    tmp.resize(n);
+                    load(tmp.data(), b, bn, n);
+                    forward(tmp.data(), n);
+                    for (size_t i = 0; i < n; ++i) {
+                        residues[i] = mul(residues[i], tmp[i]);
+                    }
+                }
+                inverse(residues.data(), n);
+            }
+        };
+
+        struct workspace {
+            transform<P0> t0;
+            transform<P1> t1;
+            transform<P2> t2;
+            std::vector<uint32_t> tmp;
+        };
+
+        workspace &thread_workspace() {
+            static thread_local workspace w;
+            return w;
+        }
+    }
+
+    void ntt_mul(uint32_t *r, const uint32_t *a, const size_t an, const uint32_t *b, const size_t bn) {
+        size_t n = 1;
+        while (n < an + bn - 1) {
+            n *= 2;
+        }
+        workspace &w = thread_workspace();
+        w.t0.convolve(a, an, b, bn, n, w.tmp);
+        w.t1.convolve(a, an, b, bn, n, w.tmp);
+        w.t2.convolve(a, an, b, bn, n, w.tmp);
+
+        ///  Garner's recombination: x = x0 + P0 * (y1 + P1 * y2)
+        const uint32_t p0_inverse_mod_p1 = pow_mod(P0, P1 - 2, P1);
+        const uint32_t p0p1_inverse_mod_p2 = pow_mod(static_cast<uint64_t>(P0) * P1 % P2, P2 - 2, P2);
+        const uint64_t p0p1 = static_cast<uint64_t>(P0) * P1;
+        uint128_t carry = 0;
+        for (size_t i = 0; i + 1 < an + bn; ++i) {
+            const uint32_t x0 = w.t0.residues[i], x1 = w.t1.residues[i], x2 = w.t2.residues[i];
+            const uint64_t y1 = static_cast<uint64_t>(x1 + P1 - x0 % P1) * p0_inverse_mod_p1 % P1;
+            const uint64_t x01 = x0 + P0 * y1;  ///  < P0 * P1
+            const uint64_t y2 = (x2 + P2 - x01 % P2) % P2 * p0p1_inverse_mod_p2 % P2;
+            carry += x01 + static_cast<uint128_t>(p0p1) * y2;
+            r[i] = static_cast<uint32_t>(carry);
+            carry >>= 32u;
+        }
+        r[an + bn - 1] = static_cast<uint32_t>(carry);
+    }
+
+    size_t ntt_reserved_bytes() {
+        const workspace &w = thread_workspace();
+        return w.t0.reserved_bytes() + w.t1.reserved_bytes() + w.t2.reserved_bytes()
+               + w.tmp.capacity() * sizeof(uint32_t);
+    }
+
+    void ntt_trim() {
+        workspace &w = thread_workspace();
+        w.t0.release();
+        w.t1.release();
+        w.t2.release();
+        std::vector<uint32_t>().swap(w.tmp);
+    }
+}
@@ -0,0 +1,24 @@
+#include <cstddef>
+#include <cstdint>
+
+#ifndef BIGINT_NTT_MULTIPLICATION_H
+#define BIGINT_NTT_MULTIPLICATION_H
+
+///  Multiplication by number-theoretic transforms modulo three primes below 2^30. The convolution of
+///  32-bit limbs is recombined from the three residues by the Chinese remainder theorem.
+///  Root tables and transform buffers are kept per thread and reused by the following calls.
+namespace limbs {
+    ///  @consts
+    const size_t NTT_MAX_SIZE = static_cast<size_t>(1) << 23u;  ///  the longest transform all three primes allow
+
+    ///  @methods
+    ///  r = a * b, r has an + bn limbs; pre: an + bn <= NTT_MAX_SIZE.
+    ///  If a and b are the same range, a single forward transform is made (squaring).
+    void ntt_mul(uint32_t *r, const uint32_t *a, size_t an, const uint32_t *b, size_t bn);
+
+    size_t ntt_reserved_bytes();  ///  held by the calling thread's tables and buffers
+
+    void ntt_trim();  ///  frees the calling thread's tables and buffers, the next call rebuilds them
+}
+
+#endif //BIGINT_NTT_MULTIPLICATION_H